@@ -0,0 +1,446 @@
+#include "graphics/framebuffer.h"
+#include "graphics/gpu.h"
+#include "graphics/heatmap.h"
+#include "graphics/optimizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <span>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace {
+
+// the original per-pixel renderer, every shape tested pixel by pixel through Framebuffer::at. the
+// kernels must produce exactly its framebuffers
+namespace reference {
+
+void plot(Framebuffer &fb, int x, int y, const Pixel &color, bool blend) {
+  Pixel &dest = fb.at(x, y);
+  dest = blend ? gpu::alpha_blend(color, dest) : color;
+}
+
+void render(const gpu::Rect &instr, Framebuffer &fb) {
+  if (instr.color.a == 0)
+    return;
+  const bool blend = instr.color.a != std::numeric_limits<std::uint8_t>::max();
+  const auto x_start = std::max(instr.pos[0], std::int16_t{0});
+  const auto x_end = std::min(static_cast<std::int16_t>(instr.pos[0] + instr.size[0]),
+                              static_cast<std::int16_t>(fb.width()));
+  const auto y_start = std::max(instr.pos[1], std::int16_t{0});
+  const auto y_end = std::min(static_cast<std::int16_t>(instr.pos[1] + instr.size[1]),
+                              static_cast<std::int16_t>(fb.height()));
+  for (auto y = y_start; y < y_end; ++y) {
+    for (auto x = x_start; x < x_end; ++x)
+      plot(fb, x, y, instr.color, blend);
+  }
+}
+
+void render(const gpu::Circle &instr, Framebuffer &fb) {
+  if (instr.color.a == 0)
+    return;
+  const bool blend = instr.color.a != std::numeric_limits<std::uint8_t>::max();
+  const std::int64_t r2 = instr.radius * instr.radius;
+  for (int y = instr.pos[1] - instr.radius; y <= instr.pos[1] + instr.radius; ++y) {
+    for (int x = instr.pos[0] - instr.radius; x <= instr.pos[0] + instr.radius; ++x) {
+      const std::int64_t dx = x - instr.pos[0];
+      const std::int64_t dy = y - instr.pos[1];
+      if (x >= 0 && x < fb.width() && y >= 0 && y < fb.height() && dx * dx + dy * dy <= r2)
+        plot(fb, x, y, instr.color, blend);
+    }
+  }
+}
+
+void render(const gpu::Line &instr, Framebuffer &fb) {
+  if (instr.color.a == 0)
+    return;
+  const bool blend = instr.color.a != std::numeric_limits<std::uint8_t>::max();
+  int x0 = instr.start[0], y0 = instr.start[1];
+  int x1 = instr.end[0], y1 = instr.end[1];
+  const bool steep = std::abs(y1 - y0) > std::abs(x1 - x0);
+  if (steep) {
+    std::swap(x0, y0);
+    std::swap(x1, y1);
+  }
+  if (x0 > x1) {
+    std::swap(x0, x1);
+    std::swap(y0, y1);
+  }
+  const int dx = x1 - x0;
+  const int dy = std::abs(y1 - y0);
+  const int ystep = y0 < y1 ? 1 : -1;
+  int error = 0;
+  int y = y0;
+  for (int x = x0; x <= x1; ++x) {
+    const int px = steep ? y : x;
+    const int py = steep ? x : y;
+    if (px >= 0 && px < fb.width() && py >= 0 && py < fb.height())
+      plot(fb, px, py, instr.color, blend);
+    error += dy;
+    if (2 * error >= dx) {
+      y += ystep;
+      error -= dx;
+    }
+  }
+}
+
+// nearest-neighbor with a division per pixel
+void render(const gpu::Blit &instr, Framebuffer &fb) {
+  const Framebuffer *source = instr.source;
+  const int src_w = instr.src_size[0], src_h = instr.src_size[1];
+  const int dst_w = instr.size[0], dst_h = instr.size[1];
+  if (source == nullptr || src_w <= 0 || src_h <= 0 || dst_w <= 0 || dst_h <= 0)
+    return;
+  for (int dy = 0; dy < dst_h; ++dy) {
+    for (int dx = 0; dx < dst_w; ++dx) {
+      const int x = instr.pos[0] + dx, y = instr.pos[1] + dy;
+      const int sx = instr.src_pos[0] + dx * src_w / dst_w;
+      const int sy = instr.src_pos[1] + dy * src_h / dst_h;
+      if (x >= 0 && x < fb.width() && y >= 0 && y < fb.height() && sx >= 0 &&
+          sx < source->width() && sy >= 0 && sy < source->height())
+        plot(fb, x, y, source->at(sx, sy), instr.blend);
+    }
+  }
+}
+
+void render(const gpu::Instruction &instr, Framebuffer &fb) {
+  std::visit([&fb](const auto &shape) { render(shape, fb); }, instr);
+}
+
+} // namespace reference
+
+constexpr int WIDTH = 67; // not a multiple of the tile size, so partial tiles are covered
+constexpr int HEIGHT = 45;
+
+Pixel random_color(std::mt19937 &rng) {
+  // mostly the opaque and transparent special cases, the rest blended
+  static constexpr std::uint8_t ALPHAS[] = {0, 255, 255, 128, 1, 254};
+  const auto alpha = rng() % 4 == 0 ? static_cast<std::uint8_t>(rng()) : ALPHAS[rng() % 6];
+  return Pixel(static_cast<std::uint8_t>(rng()), static_cast<std::uint8_t>(rng()),
+               static_cast<std::uint8_t>(rng()), alpha);
+}
+
+std::int16_t random_coordinate(std::mt19937 &rng, int size) {
+  return static_cast<std::int16_t>(static_cast<int>(rng() % (size + 60)) - 30);
+}
+
+// a blit from one of the sources, scaled up or down, sometimes entirely inside both framebuffers
+// so the unclipped kernel runs, otherwise around and across their edges
+gpu::Blit random_blit(std::mt19937 &rng, std::span<const Framebuffer *const> sources) {
+  const Framebuffer *source = sources[rng() % sources.size()];
+  const int src_w = source->width(), src_h = source->height();
+  gpu::Blit blit{source, {}, {}, {}, {}, rng() % 2 == 0};
+  if (rng() % 3 == 0) {
+    blit.src_size = {static_cast<std::int16_t>(1 + rng() % src_w),
+                     static_cast<std::int16_t>(1 + rng() % src_h)};
+    blit.src_pos = {static_cast<std::int16_t>(rng() % (src_w - blit.src_size[0] + 1)),
+                    static_cast<std::int16_t>(rng() % (src_h - blit.src_size[1] + 1))};
+    blit.size = {static_cast<std::int16_t>(1 + rng() % WIDTH),
+                 static_cast<std::int16_t>(1 + rng() % HEIGHT)};
+    blit.pos = {static_cast<std::int16_t>(rng() % (WIDTH - blit.size[0] + 1)),
+                static_cast<std::int16_t>(rng() % (HEIGHT - blit.size[1] + 1))};
+  } else {
+    blit.src_pos = {random_coordinate(rng, src_w), random_coordinate(rng, src_h)};
+    blit.src_size = {static_cast<std::int16_t>(static_cast<int>(rng() % 50) - 2),
+                     static_cast<std::int16_t>(static_cast<int>(rng() % 50) - 2)};
+    blit.pos = {random_coordinate(rng, WIDTH), random_coordinate(rng, HEIGHT)};
+    blit.size = {static_cast<std::int16_t>(static_cast<int>(rng() % 80) - 2),
+                 static_cast<std::int16_t>(static_cast<int>(rng() % 80) - 2)};
+  }
+  return blit;
+}
+
+// shapes around and across the framebuffer edges, with degenerate sizes mixed in
+gpu::Instruction random_instruction(std::mt19937 &rng,
+                                    std::span<const Framebuffer *const> sources) {
+  switch (rng() % 4) {
+    case 0:
+      return gpu::Rect{{random_coordinate(rng, WIDTH), random_coordinate(rng, HEIGHT)},
+                       {static_cast<std::int16_t>(static_cast<int>(rng() % 45) - 3),
+                        static_cast<std::int16_t>(static_cast<int>(rng() % 45) - 3)},
+                       random_color(rng)};
+    case 1:
+      return gpu::Circle{{random_coordinate(rng, WIDTH), random_coordinate(rng, HEIGHT)},
+                         static_cast<std::int16_t>(static_cast<int>(rng() % 30) - 2),
+                         random_color(rng)};
+    case 2:
+      return gpu::Line{{random_coordinate(rng, WIDTH), random_coordinate(rng, HEIGHT)},
+                       {random_coordinate(rng, WIDTH), random_coordinate(rng, HEIGHT)},
+                       random_color(rng)};
+    default:
+      return random_blit(rng, sources);
+  }
+}
+
+void random_fill(std::mt19937 &rng, Framebuffer &fb) {
+  for (int y = 0; y < fb.height(); ++y) {
+    for (int x = 0; x < fb.width(); ++x)
+      fb.at(x, y) = random_color(rng);
+  }
+}
+
+bool same_pixels(const Framebuffer &a, const Framebuffer &b, const char *what, int trial) {
+  for (int y = 0; y < a.height(); ++y) {
+    for (int x = 0; x < a.width(); ++x) {
+      const Pixel &p = a.at(x, y), &q = b.at(x, y);
+      if (p.r != q.r || p.g != q.g || p.b != q.b || p.a != q.a) {
+        std::printf("%s mismatch: list %d, pixel (%d, %d)\n", what, trial, x, y);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void copy_pixels(const Framebuffer &from, Framebuffer &to) {
+  for (int y = 0; y < from.height(); ++y) {
+    for (int x = 0; x < from.width(); ++x)
+      to.at(x, y) = from.at(x, y);
+  }
+}
+
+// random instruction lists rendered by the kernels must match the reference pixel for pixel, in
+// both layouts, and a tiled framebuffer's linear_data() must be the reference's rows
+bool verify_kernels(int trials) {
+  std::mt19937 rng(28);
+  Framebuffer initial(WIDTH, HEIGHT);
+  Framebuffer expected(WIDTH, HEIGHT);
+  Framebuffer linear(WIDTH, HEIGHT, FramebufferLayout::LINEAR);
+  Framebuffer tiled(WIDTH, HEIGHT, FramebufferLayout::TILED);
+  // blit sources in both layouts, sized off the tile grid
+  Framebuffer linear_source(23, 19, FramebufferLayout::LINEAR);
+  Framebuffer tiled_source(29, 13, FramebufferLayout::TILED);
+  const Framebuffer *const sources[] = {&linear_source, &tiled_source};
+  std::vector<gpu::Instruction> instrs;
+  for (int trial = 0; trial < trials; ++trial) {
+    random_fill(rng, linear_source);
+    random_fill(rng, tiled_source);
+    instrs.clear();
+    const int count = static_cast<int>(rng() % 40);
+    for (int k = 0; k < count; ++k)
+      instrs.push_back(random_instruction(rng, sources));
+    random_fill(rng, initial);
+    copy_pixels(initial, expected);
+    for (const auto &instr : instrs)
+      reference::render(instr, expected);
+
+    for (Framebuffer *actual : {&linear, &tiled}) {
+      copy_pixels(initial, *actual);
+      for (const auto &instr : instrs)
+        gpu::render(instr, *actual);
+      if (!same_pixels(expected, *actual,
+                       actual == &tiled ? "tiled kernel" : "linear kernel", trial))
+        return false;
+    }
+    const Pixel *rows = tiled.linear_data();
+    for (int k = 0; k < WIDTH * HEIGHT; ++k) {
+      const Pixel &p = expected.data()[k];
+      if (p.r != rows[k].r || p.g != rows[k].g || p.b != rows[k].b || p.a != rows[k].a) {
+        std::printf("linear_data mismatch: list %d, pixel %d\n", trial, k);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// a rect cut into strips along one axis, pushed in order, which optimize() should merge back.
+// strips sometimes overlap, which only opaque ones may be merged across
+void push_strips(std::mt19937 &rng, std::vector<gpu::Instruction> &instrs) {
+  const Pixel color = random_color(rng);
+  const int axis = static_cast<int>(rng() % 2);
+  gpu::Rect strip{{random_coordinate(rng, WIDTH), random_coordinate(rng, HEIGHT)},
+                  {static_cast<std::int16_t>(1 + rng() % 30),
+                   static_cast<std::int16_t>(1 + rng() % 30)},
+                  color};
+  const int strips = 2 + static_cast<int>(rng() % 5);
+  for (int k = 0; k < strips; ++k) {
+    instrs.push_back(strip);
+    const int overlap = rng() % 2 == 0 ? static_cast<int>(rng() % 3) : 0;
+    strip.pos[axis] = static_cast<std::int16_t>(strip.pos[axis] + strip.size[axis] - overlap);
+    strip.size[axis] = static_cast<std::int16_t>(1 + rng() % 12);
+  }
+}
+
+// optimize() must not change what a list renders: the optimized list, rendered by the kernels in
+// both layouts, must match the reference rendering of the original list
+bool verify_optimizer(int trials) {
+  std::mt19937 rng(27);
+  Framebuffer initial(WIDTH, HEIGHT);
+  Framebuffer expected(WIDTH, HEIGHT);
+  Framebuffer linear(WIDTH, HEIGHT, FramebufferLayout::LINEAR);
+  Framebuffer tiled(WIDTH, HEIGHT, FramebufferLayout::TILED);
+  Framebuffer source(23, 19, FramebufferLayout::TILED);
+  const Framebuffer *const sources[] = {&source};
+  std::vector<gpu::Instruction> instrs;
+  gpu::OptimizeStats total;
+  for (int trial = 0; trial < trials; ++trial) {
+    random_fill(rng, source);
+    instrs.clear();
+    const int groups = static_cast<int>(rng() % 12);
+    for (int k = 0; k < groups; ++k) {
+      if (rng() % 2 == 0)
+        push_strips(rng, instrs);
+      else
+        instrs.push_back(random_instruction(rng, sources));
+    }
+    random_fill(rng, initial);
+    copy_pixels(initial, expected);
+    for (const auto &instr : instrs)
+      reference::render(instr, expected);
+
+    const auto stats = gpu::optimize(instrs, WIDTH, HEIGHT);
+    total.input += stats.input;
+    total.output += stats.output;
+    total.merged += stats.merged;
+    for (Framebuffer *actual : {&linear, &tiled}) {
+      copy_pixels(initial, *actual);
+      for (const auto &instr : instrs)
+        gpu::render(instr, *actual);
+      if (!same_pixels(expected, *actual,
+                       actual == &tiled ? "optimized tiled" : "optimized linear", trial))
+        return false;
+    }
+  }
+  // the lists must actually have exercised merging
+  if (total.merged == 0) {
+    std::printf("optimizer check merged no rects\n");
+    return false;
+  }
+  std::printf("optimizer: %d instructions in, %d out, %d rects merged\n", total.input,
+              total.output, total.merged);
+  return true;
+}
+
+// scatter and resolve must match counting every entity into its pixel one by one and mapping the
+// counts through the lut with Framebuffer::at, for weighted and unweighted scatters, grids larger
+// and smaller than the framebuffer, and luts with blended entries
+bool verify_heatmap(int trials) {
+  std::mt19937 rng(26);
+  const gpu::HeatmapLUT heat = gpu::make_heat_lut();
+  gpu::HeatmapLUT blended;
+  for (auto &entry : blended)
+    entry = random_color(rng);
+  Framebuffer initial(WIDTH, HEIGHT);
+  Framebuffer expected(WIDTH, HEIGHT);
+  Framebuffer linear(WIDTH, HEIGHT, FramebufferLayout::LINEAR);
+  Framebuffer tiled(WIDTH, HEIGHT, FramebufferLayout::TILED);
+  std::vector<Eigen::Vector2<std::int16_t>> positions;
+  std::vector<std::uint16_t> weights;
+  for (int trial = 0; trial < trials; ++trial) {
+    const int grid_w = WIDTH - 10 + static_cast<int>(rng() % 20);
+    const int grid_h = HEIGHT - 10 + static_cast<int>(rng() % 20);
+    const bool weighted = rng() % 2 == 0;
+    const auto &lut = rng() % 2 == 0 ? heat : blended;
+    const auto max_count = rng() % 2 == 0 ? 0 : static_cast<std::uint32_t>(1 + rng() % 500);
+    positions.resize(rng() % 3000);
+    weights.resize(weighted ? positions.size() : 0);
+    for (auto &position : positions)
+      position = {random_coordinate(rng, grid_w), random_coordinate(rng, grid_h)};
+    for (auto &weight : weights)
+      weight = static_cast<std::uint16_t>(rng() % 4 == 0 ? rng() : rng() % 8);
+    random_fill(rng, initial);
+
+    std::vector<std::uint32_t> counts(static_cast<std::size_t>(grid_w) * grid_h, 0);
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+      const int x = positions[i][0], y = positions[i][1];
+      if (x >= 0 && x < grid_w && y >= 0 && y < grid_h)
+        counts[y * grid_w + x] += weighted ? weights[i] : 1;
+    }
+    const std::uint32_t largest = *std::max_element(counts.begin(), counts.end());
+    const std::uint32_t normalize = max_count != 0 ? max_count : largest;
+    copy_pixels(initial, expected);
+    for (int y = 0; y < std::min(grid_h, HEIGHT) && normalize != 0; ++y) {
+      for (int x = 0; x < std::min(grid_w, WIDTH); ++x) {
+        const std::uint32_t c = counts[y * grid_w + x];
+        if (c == 0)
+          continue;
+        const auto scaled = static_cast<std::uint64_t>(std::min(c, normalize)) * 255 / normalize;
+        const Pixel &color = lut[std::max<std::uint64_t>(scaled, 1)];
+        if (color.a != 0)
+          reference::plot(expected, x, y, color, color.a != 255);
+      }
+    }
+
+    gpu::Heatmap heatmap(grid_w, grid_h);
+    heatmap.scatter(positions, weights);
+    for (Framebuffer *actual : {&linear, &tiled}) {
+      copy_pixels(initial, *actual);
+      const std::uint32_t used = heatmap.resolve(*actual, lut, max_count);
+      if (used != (largest == 0 && max_count == 0 ? 0 : normalize)) {
+        std::printf("heatmap normalization mismatch: list %d\n", trial);
+        return false;
+      }
+      if (!same_pixels(expected, *actual,
+                       actual == &tiled ? "tiled heatmap" : "linear heatmap", trial))
+        return false;
+    }
+  }
+  return true;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// one random list rendered repeatedly by the reference and by the kernels in each layout
+void bench_render(int count, int frames) {
+  std::mt19937 rng(1);
+  Framebuffer linear_source(23, 19, FramebufferLayout::LINEAR);
+  Framebuffer tiled_source(29, 13, FramebufferLayout::TILED);
+  random_fill(rng, linear_source);
+  random_fill(rng, tiled_source);
+  const Framebuffer *const sources[] = {&linear_source, &tiled_source};
+  std::vector<gpu::Instruction> instrs;
+  for (int k = 0; k < count; ++k)
+    instrs.push_back(random_instruction(rng, sources));
+
+  const auto time = [&](Framebuffer &fb, auto &&render) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; ++frame) {
+      for (const auto &instr : instrs)
+        render(instr, fb);
+    }
+    return static_cast<double>(count) * frames / seconds_since(start);
+  };
+  Framebuffer reference_fb(WIDTH, HEIGHT);
+  Framebuffer linear(WIDTH, HEIGHT, FramebufferLayout::LINEAR);
+  Framebuffer tiled(WIDTH, HEIGHT, FramebufferLayout::TILED);
+  const auto reference = [](const gpu::Instruction &instr, Framebuffer &fb) {
+    reference::render(instr, fb);
+  };
+  const auto kernels = [](const gpu::Instruction &instr, Framebuffer &fb) {
+    gpu::render(instr, fb);
+  };
+  const double per_pixel = time(reference_fb, reference);
+  const double linear_rate = time(linear, kernels);
+  const double tiled_rate = time(tiled, kernels);
+  std::printf("render %5d instructions: %.3e instructions/s reference, %.3e linear kernels, "
+              "%.3e tiled kernels\n",
+              count, per_pixel, linear_rate, tiled_rate);
+}
+
+} // namespace
+
+int main() {
+  if (!verify_kernels(2000)) {
+    return 1;
+  }
+  std::printf("verify: linear and tiled render kernels match the per-pixel reference\n");
+  if (!verify_optimizer(2000)) {
+    return 1;
+  }
+  std::printf("verify: optimized lists render the same framebuffers\n");
+  if (!verify_heatmap(500)) {
+    return 1;
+  }
+  std::printf("verify: heatmap matches per-entity counting\n");
+
+  bench_render(1000, 200);
+  return 0;
+}
@@ -0,0 +1,1948 @@
+#include "systems/frozen_snn.h"
+#include "systems/genome_archive.h"
+#include "systems/sensory_encoder.h"
+#include "systems/snn.h"
+#include "systems/snn_arena.h"
+#include "systems/snn_core_model.h"
+#include "systems/snn_fitness.h"
+#include "systems/snn_genetics.h"
+#include "systems/snn_partitioned.h"
+#include "systems/snn_population.h"
+#include "systems/snn_readout.h"
+#include "systems/snn_stdp.h"
+#include "systems/spike_recorder.h"
+#include "systems/spike_stream.h"
+#include "systems/sparse_snn.h"
+
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <omp.h>
+
+namespace {
+
+constexpr int INPUTS = 16;
+constexpr int HIDDEN = 32;
+constexpr int OUTPUTS = 8;
+
+using Network = SNN<INPUTS, HIDDEN, OUTPUTS>;
+using Population = SNNPopulation<INPUTS, HIDDEN, OUTPUTS>;
+
+// champion weights made at compile time, the way snn_freeze's headers declare them. density_percent
+// of the recurrent and input weights are nonzero
+constexpr FrozenWeights<INPUTS, HIDDEN, OUTPUTS> frozen_weights(uint32_t seed,
+                                                                int density_percent) {
+  FrozenWeights<INPUTS, HIDDEN, OUTPUTS> weights{};
+  uint32_t state = seed;
+  const auto next = [&state] {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+  };
+  const auto draw = [&](int range) {
+    const auto keep = static_cast<int>(next() % 100) < density_percent;
+    const auto w = static_cast<int>(next() % (2 * range + 1)) - range;
+    return static_cast<int8_t>(keep ? w : 0);
+  };
+  for (auto &w : weights.w_hidden_input)
+    w = draw(22);
+  for (auto &w : weights.w_hidden_hidden)
+    w = draw(22);
+  for (auto &w : weights.w_output_hidden)
+    w = static_cast<int8_t>(static_cast<int>(next() % 45) - 22);
+  for (auto &b : weights.b_hidden)
+    b = static_cast<uint8_t>(11 + next() % 12);
+  return weights;
+}
+constexpr auto FROZEN_DENSE = frozen_weights(3, 100);
+constexpr auto FROZEN_SPARSE = frozen_weights(4, 20);
+
+void random_input(std::mt19937 &rng, std::vector<int8_t> &input) {
+  std::uniform_int_distribution<int> dist(-127, 127);
+  for (auto &v : input)
+    v = static_cast<int8_t>(dist(rng));
+}
+
+// steps every network both ways and checks that state, activations and outputs agree
+bool verify_population(int size, int steps) {
+  std::mt19937 rng(1234);
+  std::vector<Network> networks(size);
+  Population population(size);
+  for (int n = 0; n < size; ++n) {
+    networks[n].init(rng);
+    population.set_network(n, networks[n]);
+  }
+
+  std::vector<int8_t> input(size * INPUTS);
+  std::vector<int16_t> expected, actual;
+  for (int step = 0; step < steps; ++step) {
+    random_input(rng, input);
+    population.update(input);
+    population.get_output(actual);
+    for (int n = 0; n < size; ++n) {
+      networks[n].update(std::span<int8_t const>(&input[n * INPUTS], INPUTS));
+      networks[n].get_output(expected);
+      for (int i = 0; i < HIDDEN; ++i) {
+        if (networks[n].spiked(i) != population.spiked(n, i) ||
+            networks[n].s_hidden[i] != population.state(n, i)) {
+          std::printf("population mismatch: step %d network %d neuron %d\n", step, n, i);
+          return false;
+        }
+      }
+      for (int j = 0; j < OUTPUTS; ++j) {
+        if (expected[j] != actual[n * OUTPUTS + j]) {
+          std::printf("population output mismatch: step %d network %d output %d\n", step, n, j);
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+// networks biased low enough to rest without input, most of them given constant input so their
+// blocks settle and get skipped. every step must still match SNN::update
+bool verify_quiescence(int size, int steps) {
+  std::mt19937 rng(73);
+  std::vector<Network> networks(size);
+  Population population(size);
+  for (int n = 0; n < size; ++n) {
+    networks[n].init(rng);
+    for (auto &b : networks[n].b_hidden)
+      b /= 2;
+    population.set_network(n, networks[n]);
+  }
+
+  std::vector<int8_t> input(size * INPUTS, 0);
+  std::vector<int16_t> expected, actual;
+  for (int step = 0; step < steps; ++step) {
+    // skipping is turned off for a stretch, which leaves the blocks' last inputs stale
+    if (step == steps / 4 || step == steps / 3)
+      population.set_skip_quiescent(step == steps / 3);
+    // the first 32 networks see new input every step until halfway, the rest only now and then
+    for (int n = 0; n < size; ++n) {
+      if ((n < 32 && step < steps / 2) || rng() % 200 == 0) {
+        for (int j = 0; j < INPUTS; ++j)
+          input[n * INPUTS + j] = static_cast<int8_t>(rng() % 64);
+      }
+    }
+    population.update(input);
+    population.get_output(actual);
+    for (int n = 0; n < size; ++n) {
+      networks[n].update(std::span<int8_t const>(&input[n * INPUTS], INPUTS));
+      networks[n].get_output(expected);
+      bool same = std::equal(expected.begin(), expected.end(), &actual[n * OUTPUTS]);
+      for (int i = 0; i < HIDDEN; ++i)
+        same = same && networks[n].spiked(i) == population.spiked(n, i) &&
+               networks[n].s_hidden[i] == population.state(n, i);
+      if (!same) {
+        std::printf("quiescence mismatch: step %d network %d\n", step, n);
+        return false;
+      }
+    }
+  }
+  if (population.skipped_updates() == 0) {
+    std::printf("no block ever went quiescent\n");
+    return false;
+  }
+  return true;
+}
+
+// steps a network with column accumulation and a copy with bit-planes
+template <int hidden> bool verify_bitplanes(int steps) {
+  std::mt19937 rng(99);
+  auto columns = std::make_unique<SNN<INPUTS, hidden, OUTPUTS>>();
+  columns->init(rng);
+  auto planes_net = std::make_unique<SNN<INPUTS, hidden, OUTPUTS>>(*columns);
+  auto planes = std::make_unique<SNNBitPlanes<hidden>>();
+  planes->pack(planes_net->w_hidden_hidden);
+
+  std::vector<int8_t> input(INPUTS);
+  for (int step = 0; step < steps; ++step) {
+    random_input(rng, input);
+    columns->update(input);
+    planes_net->update(input, *planes);
+    if (columns->s_hidden != planes_net->s_hidden ||
+        columns->act_hidden != planes_net->act_hidden) {
+      std::printf("bit-plane mismatch: hidden %d step %d\n", hidden, step);
+      return false;
+    }
+  }
+  return true;
+}
+
+// a dense network loaded into a sparse one (zeros dropped) must step identically
+template <int hidden, template <int> class Recurrent> bool verify_sparse(int steps) {
+  std::mt19937 rng(5);
+  auto dense = std::make_unique<SNN<INPUTS, hidden, OUTPUTS>>();
+  dense->init(rng);
+  // prune most of the recurrent weights so the sparse path has something to skip
+  std::uniform_int_distribution<int> keep(0, 9);
+  for (auto &w : dense->w_hidden_hidden)
+    if (keep(rng) != 0)
+      w = 0;
+  SparseSNN<INPUTS, hidden, OUTPUTS, Recurrent> sparse;
+  sparse.load(*dense);
+
+  std::vector<int8_t> input(INPUTS);
+  std::vector<int16_t> expected, actual;
+  for (int step = 0; step < steps; ++step) {
+    random_input(rng, input);
+    dense->update(input);
+    sparse.update(input);
+    dense->get_output(expected);
+    sparse.get_output(actual);
+    if (!std::equal(dense->s_hidden.begin(), dense->s_hidden.end(), sparse.s_hidden.begin()) ||
+        !std::equal(dense->act_hidden.begin(), dense->act_hidden.end(),
+                    sparse.act_hidden.begin()) ||
+        expected != actual) {
+      std::printf("sparse mismatch: hidden %d step %d\n", hidden, step);
+      return false;
+    }
+  }
+  return true;
+}
+
+// networks of a compiled-in and an odd shape, stepped in an arena and standalone. the first is
+// then grown by a neuron with no connections, which must not change what the others do
+bool verify_arena(int steps) {
+  std::mt19937 rng(21);
+  SNN<INPUTS, HIDDEN, OUTPUTS> common;
+  SNN<7, 45, 3> odd;
+  common.init(rng);
+  odd.init(rng);
+  SNNArena arena;
+  arena.add({1, 1, 1});
+  arena.add({1, 1, 1});
+  arena.load(0, common);
+  arena.load(1, odd);
+  if (!arena.compiled(0) || arena.compiled(1)) {
+    std::printf("arena picked the wrong kernels\n");
+    return false;
+  }
+
+  std::vector<int8_t> input(INPUTS + 7);
+  std::vector<int16_t> expected, actual;
+  for (int step = 0; step < steps; ++step) {
+    if (step == steps / 2) {
+      arena.reshape(0, {INPUTS, HIDDEN + 1, OUTPUTS});
+      arena.compact();
+      common.clear();
+    }
+    random_input(rng, input);
+    arena.update(input);
+    common.update(std::span<int8_t const>(&input[arena.input_offset(0)], INPUTS));
+    odd.update(std::span<int8_t const>(&input[arena.input_offset(1)], 7));
+
+    bool same = arena.spiked(0, HIDDEN) == false;
+    for (int i = 0; i < HIDDEN; ++i)
+      same = same && arena.spiked(0, i) == common.spiked(i) &&
+             arena.s_hidden(0)[i] == common.s_hidden[i];
+    for (int i = 0; i < 45; ++i)
+      same = same && arena.spiked(1, i) == odd.spiked(i) && arena.s_hidden(1)[i] == odd.s_hidden[i];
+    common.get_output(expected);
+    arena.get_output(0, actual);
+    same = same && expected == actual;
+    odd.get_output(expected);
+    arena.get_output(1, actual);
+    same = same && expected == actual;
+    if (!same) {
+      std::printf("arena mismatch: step %d\n", step);
+      return false;
+    }
+  }
+  return true;
+}
+
+// an arena's spikes published to a small stream while two threads consume it. both consumers must
+// see the same events, in order, and every event that wasn't dropped
+bool verify_spike_stream(int size, int steps) {
+  std::mt19937 rng(47);
+  SNNArena arena;
+  for (int n = 0; n < size; ++n)
+    arena.init(arena.add({INPUTS, HIDDEN, OUTPUTS}), rng);
+  std::vector<int8_t> input(arena.input_size());
+  auto stream = std::make_unique<SpikeStream<1024, 2>>();
+  const int consumers[] = {stream->subscribe(), stream->subscribe()};
+  if (stream->subscribe() != -1) {
+    std::printf("spike stream handed out more consumers than it has\n");
+    return false;
+  }
+
+  std::atomic<bool> done{false};
+  std::vector<SpikeEvent> seen[2];
+  std::vector<std::thread> threads;
+  for (int c = 0; c < 2; ++c) {
+    threads.emplace_back([&, c] {
+      const auto record = [&](const SpikeEvent &event) { seen[c].push_back(event); };
+      while (!done.load(std::memory_order_acquire))
+        stream->poll(consumers[c], record);
+      stream->poll(consumers[c], record);
+    });
+  }
+  std::vector<SpikeEvent> expected;
+  for (int step = 0; step < steps; ++step) {
+    random_input(rng, input);
+    arena.update(input);
+    for (int n = 0; n < size; ++n) {
+      stream->publish(n, step, arena.act(n));
+      for (int i = 0; i < HIDDEN; ++i) {
+        if (arena.spiked(n, i))
+          expected.push_back({static_cast<uint32_t>(step), static_cast<uint32_t>(n),
+                              static_cast<uint32_t>(i)});
+      }
+    }
+  }
+  done.store(true, std::memory_order_release);
+  for (auto &thread : threads)
+    thread.join();
+
+  const auto same = [](const SpikeEvent &a, const SpikeEvent &b) {
+    return a.tick == b.tick && a.network == b.network && a.neuron == b.neuron;
+  };
+  for (const auto &events : seen) {
+    // dropped events are batch tails, so what arrived must be an ordered subsequence
+    std::size_t k = 0;
+    for (const auto &event : events) {
+      while (k < expected.size() && !same(expected[k], event))
+        ++k;
+      if (k++ == expected.size()) {
+        std::printf("spike stream delivered an event out of order\n");
+        return false;
+      }
+    }
+    if (events.size() != stream->published() ||
+        stream->published() + stream->dropped() != expected.size()) {
+      std::printf("spike stream lost events: %zu seen, %llu published, %llu dropped, %zu sent\n",
+                  events.size(), static_cast<unsigned long long>(stream->published()),
+                  static_cast<unsigned long long>(stream->dropped()), expected.size());
+      return false;
+    }
+  }
+  return true;
+}
+
+// harness statistics must match stepping each genome on its own
+bool verify_fitness(int size, int steps) {
+  std::mt19937 rng(77);
+  FourierFeatures<INPUTS> features;
+  features.init(rng);
+  const auto trajectory = fourier_trajectory(features, steps, 2.0f, rng);
+  std::vector<Network> genomes(size);
+  for (auto &genome : genomes)
+    genome.init(rng);
+
+  SNNFitnessHarness<INPUTS, HIDDEN, OUTPUTS> harness;
+  std::vector<SNNEvaluation<OUTPUTS>> results;
+  harness.evaluate(genomes, trajectory, results);
+
+  std::vector<int16_t> output;
+  for (int n = 0; n < size; ++n) {
+    Network net = genomes[n];
+    SNNEvaluation<OUTPUTS> expected;
+    expected.steps = steps;
+    expected.output_min.fill(std::numeric_limits<int16_t>::max());
+    expected.output_max.fill(std::numeric_limits<int16_t>::min());
+    for (int step = 0; step < steps; ++step) {
+      net.update(std::span<int8_t const>(&trajectory[step * INPUTS], INPUTS));
+      net.get_output(output);
+      for (int i = 0; i < HIDDEN; ++i)
+        expected.spikes += net.spiked(i);
+      for (int j = 0; j < OUTPUTS; ++j) {
+        expected.output_sum[j] += output[j];
+        expected.output_sq_sum[j] += output[j] * output[j];
+        expected.output_min[j] = std::min(expected.output_min[j], output[j]);
+        expected.output_max[j] = std::max(expected.output_max[j], output[j]);
+      }
+    }
+    const auto &actual = results[n];
+    if (expected.spikes != actual.spikes || expected.output_sum != actual.output_sum ||
+        expected.output_sq_sum != actual.output_sq_sum ||
+        expected.output_min != actual.output_min || expected.output_max != actual.output_max) {
+      std::printf("fitness mismatch: genome %d\n", n);
+      return false;
+    }
+  }
+  return true;
+}
+
+// properties of the genetic operators: determinism, masks, crossover only copying from parents,
+// and genomes round-tripping through SNN
+bool verify_genetics() {
+  using Pool = SNNGenomePool<INPUTS, HIDDEN, OUTPUTS>;
+  std::mt19937 rng(3);
+  Pool parents(2), children(3);
+  Network a, b, roundtrip;
+  a.init(rng);
+  b.init(rng);
+  parents.load(0, a);
+  parents.load(1, b);
+  parents.store(0, roundtrip);
+  if (roundtrip.w_hidden_hidden != a.w_hidden_hidden || roundtrip.b_hidden != a.b_hidden) {
+    std::printf("genome round trip mismatch\n");
+    return false;
+  }
+
+  const CounterRNG counter{42};
+  MutationParams params;
+  params.weight_rate = 0.5f;
+  params.weight_sigma = 100.0f;
+  params.remove_rate = 0.2f;
+  children.crossover_neurons(0, parents, 0, 1, counter, 7);
+  children.crossover_uniform(1, parents, 0, 1, counter, 7);
+  for (int k = 0; k < Pool::WEIGHTS; ++k) {
+    for (int c = 0; c < 2; ++c) {
+      const int8_t w = children.weights(c)[k];
+      if (w != parents.weights(0)[k] && w != parents.weights(1)[k]) {
+        std::printf("crossover child %d has a weight from neither parent\n", c);
+        return false;
+      }
+    }
+  }
+  children.copy(2, children, 0);
+  children.mutate(0, params, counter, 11);
+  children.mutate(2, params, counter, 11);
+  if (!std::ranges::equal(children.weights(0), children.weights(2)) ||
+      !std::ranges::equal(children.bias(0), children.bias(2))) {
+    std::printf("mutation is not deterministic\n");
+    return false;
+  }
+  int pruned = 0;
+  for (int k = 0; k < Pool::WEIGHTS; ++k) {
+    if (children.mask(0)[k] == 0) {
+      ++pruned;
+      if (children.weights(0)[k] != 0) {
+        std::printf("pruned weight %d is not zero\n", k);
+        return false;
+      }
+    }
+  }
+  if (pruned == 0) {
+    std::printf("structural mutation pruned nothing\n");
+    return false;
+  }
+  return true;
+}
+
+std::string temp_path(const char *name) {
+  return (std::filesystem::temp_directory_path() / name).string();
+}
+
+// records written, flushed and reopened must read back unchanged, and top_k must agree with a
+// full sort of the fitness values
+bool verify_archive() {
+  using Pool = SNNGenomePool<INPUTS, HIDDEN, OUTPUTS>;
+  const std::string path = temp_path("snn_bench_verify.archive");
+  std::filesystem::remove(path);
+  std::filesystem::remove(path + ".index");
+
+  std::mt19937 rng(8);
+  std::uniform_real_distribution<float> dist_fitness(-10.0f, 10.0f);
+  Pool pool(200);
+  Network net;
+  std::vector<float> fitness(pool.size());
+  {
+    GenomeArchive archive;
+    if (!archive.open(path, Pool::RECORD))
+      return false;
+    for (int g = 0; g < pool.size(); ++g) {
+      net.init(rng);
+      pool.load(g, net);
+      fitness[g] = dist_fitness(rng);
+      archive.append(pool.record(g), fitness[g], g / 50);
+    }
+    if (!archive.flush())
+      return false;
+  }
+
+  GenomeArchive archive;
+  if (!archive.open(path, Pool::RECORD) || archive.size() != static_cast<uint64_t>(pool.size())) {
+    std::printf("archive reopen failed\n");
+    return false;
+  }
+  for (int g = 0; g < pool.size(); ++g) {
+    if (!std::ranges::equal(archive.record(g), pool.record(g)) ||
+        archive.entry(g).fitness != fitness[g]) {
+      std::printf("archive record %d mismatch\n", g);
+      return false;
+    }
+  }
+
+  std::vector<uint64_t> top, sample;
+  archive.top_k(10, top);
+  std::vector<float> sorted = fitness;
+  std::sort(sorted.begin(), sorted.end(), std::greater<float>());
+  for (int k = 0; k < 10; ++k) {
+    if (archive.entry(top[k]).fitness != sorted[k]) {
+      std::printf("archive top_k mismatch at %d\n", k);
+      return false;
+    }
+  }
+  archive.sample(100, rng, sample, 2, 2);
+  for (auto i : sample) {
+    if (archive.entry(i).generation != 2) {
+      std::printf("archive sample outside generation range\n");
+      return false;
+    }
+  }
+
+  // a different record size is a different archive
+  GenomeArchive other;
+  if (other.open(path, Pool::RECORD + 1)) {
+    std::printf("archive opened with the wrong record size\n");
+    return false;
+  }
+  archive.close();
+  std::filesystem::remove(path);
+  std::filesystem::remove(path + ".index");
+  return true;
+}
+
+// spikes recorded over many chunks, with a flush mid-chunk and a network that repeats one pattern,
+// must read back exactly for random tick ranges
+bool verify_spike_recorder(int size, int steps) {
+  const std::string path = temp_path("snn_bench_verify.spikes");
+  std::mt19937 rng(49);
+  SNNArena arena;
+  for (int n = 0; n < size; ++n)
+    arena.init(arena.add({INPUTS, HIDDEN, OUTPUTS}), rng);
+  std::vector<int8_t> input(arena.input_size());
+  // network size fires the same neurons every other tick, the last one among them, the rest are
+  // the arena's
+  static_assert(HIDDEN <= 64);
+  const std::array<uint64_t, 1> steady{(uint64_t{1} << (HIDDEN - 1)) | 0x0421};
+  std::vector<std::vector<SpikeReader::Spike>> expected(size + 1);
+  {
+    SpikeRecorder recorder;
+    if (!recorder.open(path, size + 1, HIDDEN, 64))
+      return false;
+    const std::array<uint64_t, 2> too_wide{};
+    if (recorder.record(size + 1, 0, steady) || recorder.record(0, 0, too_wide)) {
+      std::printf("spike recorder accepted a bad network or act size\n");
+      return false;
+    }
+    for (int step = 0; step < steps; ++step) {
+      random_input(rng, input);
+      arena.update(input);
+      for (int n = 0; n < size; ++n) {
+        recorder.record(n, step, arena.act(n));
+        for (int i = 0; i < HIDDEN; ++i) {
+          if (arena.spiked(n, i))
+            expected[n].push_back({static_cast<uint64_t>(step), static_cast<uint32_t>(i)});
+        }
+      }
+      if (step % 2 == 0) {
+        recorder.record(size, step, steady);
+        for (int i = 0; i < HIDDEN; ++i) {
+          if ((steady[0] >> i) & 1)
+            expected[size].push_back({static_cast<uint64_t>(step), static_cast<uint32_t>(i)});
+        }
+      }
+      // the second half also hands chunks over once a tick
+      if (step >= steps / 2)
+        recorder.end_tick();
+      if (step == steps / 3 && !recorder.flush())
+        return false;
+    }
+    if (!recorder.flush())
+      return false;
+  }
+
+  SpikeReader reader;
+  if (!reader.open(path) || reader.networks() != static_cast<uint32_t>(size + 1) ||
+      reader.chunk_ticks() != 64) {
+    std::printf("spike recording reopen failed\n");
+    return false;
+  }
+  std::vector<SpikeReader::Spike> actual;
+  if (reader.read(size + 1, 0, steps, actual)) {
+    std::printf("spike reader accepted a bad network\n");
+    return false;
+  }
+  for (int k = 0; k < 500; ++k) {
+    const int n = static_cast<int>(rng() % (size + 1));
+    uint64_t begin = rng() % (steps + 10), end = rng() % (steps + 10);
+    if (k == 0)
+      begin = 0, end = steps;
+    if (begin > end)
+      std::swap(begin, end);
+    actual.clear();
+    reader.read(n, begin, end, actual);
+    const auto first = std::ranges::find_if(
+        expected[n], [&](const SpikeReader::Spike &spike) { return spike.tick >= begin; });
+    const auto last = std::find_if(first, expected[n].end(), [&](const SpikeReader::Spike &spike) {
+      return spike.tick >= end;
+    });
+    const bool same = std::equal(first, last, actual.begin(), actual.end(),
+                                 [](const SpikeReader::Spike &a, const SpikeReader::Spike &b) {
+                                   return a.tick == b.tick && a.neuron == b.neuron;
+                                 });
+    if (!same) {
+      std::printf("spike recording mismatch: network %d ticks [%llu, %llu)\n", n,
+                  static_cast<unsigned long long>(begin), static_cast<unsigned long long>(end));
+      return false;
+    }
+  }
+  std::filesystem::remove(path);
+  std::filesystem::remove(path + ".index");
+  return true;
+}
+
+// the spike-driven STDP step against the same rule evaluated over every pair of neurons
+template <int hidden> bool verify_stdp(int steps) {
+  std::mt19937 rng(13);
+  auto net = std::make_unique<SNN<INPUTS, hidden, OUTPUTS>>();
+  net->init(rng);
+  auto reference = std::make_unique<SNN<INPUTS, hidden, OUTPUTS>>(*net);
+  SNNPlasticity<INPUTS, hidden, OUTPUTS> stdp;
+  stdp.params.a_plus = 40;
+  stdp.params.a_minus = 30;
+  stdp.params.a_input = 20;
+  std::array<uint8_t, hidden> pre{}, post{};
+  std::array<int8_t, INPUTS> trace{};
+  const auto &p = stdp.params;
+  const auto add = [](int8_t &w, int delta) {
+    w = static_cast<int8_t>(std::clamp(w + delta, -128, 127));
+  };
+
+  std::vector<int8_t> input(INPUTS);
+  for (int step = 0; step < steps; ++step) {
+    random_input(rng, input);
+    net->update(input);
+    stdp.step(*net, input);
+
+    reference->update(input);
+    for (int j = 0; j < hidden; ++j)
+      for (int i = 0; i < hidden; ++i)
+        if (reference->spiked(i))
+          add(reference->w_hidden_hidden[j * hidden + i], (p.a_plus * pre[j] + 127) / 255);
+    for (int i = 0; i < hidden; ++i)
+      for (int j = 0; j < INPUTS; ++j)
+        if (reference->spiked(i))
+          add(reference->w_hidden_input[i * INPUTS + j], (p.a_input * trace[j] + 64) >> 7);
+    for (int j = 0; j < hidden; ++j)
+      for (int i = 0; i < hidden; ++i)
+        if (reference->spiked(j))
+          add(reference->w_hidden_hidden[j * hidden + i], -((p.a_minus * post[i] + 127) / 255));
+    for (int i = 0; i < hidden; ++i) {
+      pre[i] = reference->spiked(i) ? 255 : pre[i] - (pre[i] >> p.tau_plus_shift);
+      post[i] = reference->spiked(i) ? 255 : post[i] - (post[i] >> p.tau_minus_shift);
+    }
+    for (int j = 0; j < INPUTS; ++j)
+      trace[j] = static_cast<int8_t>(trace[j] + ((input[j] - trace[j]) >> p.tau_input_shift));
+
+    if (net->w_hidden_hidden != reference->w_hidden_hidden ||
+        net->w_hidden_input != reference->w_hidden_input ||
+        net->act_hidden != reference->act_hidden) {
+      std::printf("stdp mismatch: hidden %d step %d\n", hidden, step);
+      return false;
+    }
+  }
+  return true;
+}
+
+// an int4 network must step exactly like the int8 network to_int8 makes from it
+template <int inputs, int hidden> bool verify_int4(int steps) {
+  std::mt19937 rng(31);
+  auto source = std::make_unique<SNN<inputs, hidden, OUTPUTS>>();
+  source->init(rng);
+  auto packed = std::make_unique<SNN<inputs, hidden, OUTPUTS, 4>>();
+  auto expanded = std::make_unique<SNN<inputs, hidden, OUTPUTS>>();
+  to_int4(*source, *packed);
+  to_int8(*packed, *expanded);
+
+  std::vector<int8_t> input(inputs);
+  std::vector<int16_t> expected, actual;
+  for (int step = 0; step < steps; ++step) {
+    random_input(rng, input);
+    packed->update(input);
+    expanded->update(input);
+    packed->get_output(actual);
+    expanded->get_output(expected);
+    if (packed->s_hidden != expanded->s_hidden || packed->act_hidden != expanded->act_hidden ||
+        expected != actual) {
+      std::printf("%s int4 mismatch: inputs %d hidden %d step %d\n",
+                  snn_simd::name(snn_simd::active), inputs, hidden, step);
+      return false;
+    }
+  }
+  return true;
+}
+
+// runs an int8 network and its int4 quantization on the same inputs and reports how far apart
+// their dynamics are
+template <int hidden> void compare_int4(int steps) {
+  std::mt19937 rng(17);
+  auto net8 = std::make_unique<SNN<INPUTS, hidden, OUTPUTS>>();
+  net8->init(rng);
+  auto net4 = std::make_unique<SNN<INPUTS, hidden, OUTPUTS, 4>>();
+  to_int4(*net8, *net4);
+  FourierFeatures<INPUTS> features;
+  features.init(rng);
+  const auto trajectory = fourier_trajectory(features, steps, 2.0f, rng);
+
+  std::vector<int16_t> out8, out4;
+  long agree = 0, spikes8 = 0, spikes4 = 0;
+  double state_error = 0.0, output_error = 0.0;
+  for (int step = 0; step < steps; ++step) {
+    const std::span<int8_t const> input(&trajectory[step * INPUTS], INPUTS);
+    net8->update(input);
+    net4->update(input);
+    net8->get_output(out8);
+    net4->get_output(out4);
+    for (int i = 0; i < hidden; ++i) {
+      agree += net8->spiked(i) == net4->spiked(i);
+      spikes8 += net8->spiked(i);
+      spikes4 += net4->spiked(i);
+      state_error += std::abs(net8->s_hidden[i] - net4->s_hidden[i]);
+    }
+    for (int j = 0; j < OUTPUTS; ++j)
+      output_error += std::abs(out8[j] - out4[j]);
+  }
+  const double updates = static_cast<double>(steps) * hidden;
+  std::printf("int4 vs int8 hidden %4d: spike agreement %.3f, firing rate %.3f vs %.3f, "
+              "state error %.1f, output error %.1f, weights %zu vs %zu bytes\n",
+              hidden, agree / updates, spikes4 / updates, spikes8 / updates,
+              state_error / updates, output_error / (static_cast<double>(steps) * OUTPUTS),
+              sizeof(net4->w_hidden_input) + sizeof(net4->w_hidden_hidden) +
+                  sizeof(net4->w_output_hidden),
+              sizeof(net8->w_hidden_input) + sizeof(net8->w_hidden_hidden) +
+                  sizeof(net8->w_output_hidden));
+}
+
+// the hardware core model against SNN::update, over lane counts, word widths and port counts that
+// leave rows partially filled, and zero widths, ports and scan widths, which clamp
+template <int inputs, int hidden> bool verify_core_model(int steps) {
+  std::mt19937 rng(43);
+  auto net = std::make_unique<SNN<inputs, hidden, OUTPUTS>>();
+  std::vector<int8_t> input(inputs);
+  std::vector<int16_t> expected, actual;
+  for (int lanes : {1, 3, 8}) {
+    for (int width : {0, 18, 36, 72}) {
+      for (int ports : {0, 1, 2}) {
+        net->init(rng);
+        SNNCoreConfig config{lanes, width, ports};
+        if (ports == 0)
+          config.scan_bits = 0;
+        SNNCoreModel<inputs, hidden, OUTPUTS> core(config);
+        core.load(*net);
+        for (int step = 0; step < steps; ++step) {
+          random_input(rng, input);
+          net->update(input);
+          core.update(input);
+          net->get_output(expected);
+          core.get_output(actual);
+          bool match = expected == actual;
+          for (int i = 0; i < hidden; ++i)
+            match = match && net->spiked(i) == core.spiked(i) && net->s_hidden[i] == core.state(i);
+          if (!match) {
+            std::printf("core model mismatch: hidden %d lanes %d width %d ports %d step %d\n",
+                        hidden, lanes, width, ports, step);
+            return false;
+          }
+        }
+      }
+    }
+  }
+  return true;
+}
+
+// a frozen network against SNN::update on the same weights
+template <const auto &weights> bool verify_frozen(int steps) {
+  std::mt19937 rng(59);
+  FrozenSNN<weights> frozen;
+  Network net;
+  thaw(weights, net);
+  std::vector<int8_t> input(INPUTS);
+  std::vector<int16_t> expected, actual;
+  for (int step = 0; step < steps; ++step) {
+    random_input(rng, input);
+    net.update(input);
+    frozen.update(input);
+    net.get_output(expected);
+    frozen.get_output(actual);
+    if (net.s_hidden != frozen.s_hidden || net.act_hidden != frozen.act_hidden ||
+        expected != actual) {
+      std::printf("frozen mismatch: step %d\n", step);
+      return false;
+    }
+  }
+  return true;
+}
+
+// a readout trained on a network's own outputs must give back its weights, for every neuron that
+// spiked, and the error the trainer reports must match running the network
+bool verify_readout(int steps) {
+  std::mt19937 rng(61);
+  Network teacher;
+  teacher.init(rng);
+  Network student = teacher;
+  SNNReadoutTrainer<INPUTS, HIDDEN, OUTPUTS> trainer;
+  std::vector<int8_t> input(INPUTS);
+  std::vector<int16_t> output;
+  std::vector<float> target(OUTPUTS);
+  std::array<bool, HIDDEN> fired{};
+  for (int step = 0; step < steps; ++step) {
+    random_input(rng, input);
+    teacher.update(input);
+    teacher.get_output(output);
+    std::copy(output.begin(), output.end(), target.begin());
+    trainer.record(teacher, target);
+    for (int i = 0; i < HIDDEN; ++i)
+      fired[i] = fired[i] || teacher.spiked(i);
+  }
+  const auto report = trainer.solve(1e-6, student);
+  for (int i = 0; i < HIDDEN; ++i) {
+    for (int j = 0; j < OUTPUTS && fired[i]; ++j) {
+      if (student.w_output_hidden[i * OUTPUTS + j] != teacher.w_output_hidden[i * OUTPUTS + j]) {
+        std::printf("readout didn't recover weight %d -> %d\n", i, j);
+        return false;
+      }
+    }
+  }
+  if (report.quantized_rmse > 1e-3 || report.clipped != 0) {
+    std::printf("readout reported error %g on an exact teacher\n", report.quantized_rmse);
+    return false;
+  }
+
+  // the reported error for a readout that doesn't fit, against running it
+  for (auto &w : student.w_output_hidden)
+    w = static_cast<int8_t>(rng() % 61 - 30);
+  student.clear();
+  teacher.clear();
+  trainer.clear();
+  double error = 0.0;
+  for (int step = 0; step < steps; ++step) {
+    random_input(rng, input);
+    teacher.update(input);
+    student.update(input);
+    teacher.get_output(output);
+    std::copy(output.begin(), output.end(), target.begin());
+    trainer.record(teacher, target);
+    student.get_output(output);
+    for (int j = 0; j < OUTPUTS; ++j)
+      error += (output[j] - target[j]) * (output[j] - target[j]);
+  }
+  Eigen::MatrixXd w(HIDDEN, OUTPUTS);
+  for (int i = 0; i < HIDDEN; ++i) {
+    for (int j = 0; j < OUTPUTS; ++j)
+      w(i, j) = student.w_output_hidden[i * OUTPUTS + j];
+  }
+  const double measured = std::sqrt(error / (static_cast<double>(steps) * OUTPUTS));
+  if (std::abs(trainer.rmse(w) - measured) > 1e-6 * measured) {
+    std::printf("readout error %g, measured %g\n", trainer.rmse(w), measured);
+    return false;
+  }
+  return true;
+}
+
+// one network stepped by a thread team against SNN::update, for team sizes that leave some threads
+// without a range and a hidden size that isn't whole words
+template <int hidden> bool verify_partitioned(int steps) {
+  std::mt19937 rng(71);
+  auto reference = std::make_unique<SNN<INPUTS, hidden, OUTPUTS>>();
+  auto partitioned = std::make_unique<SNN<INPUTS, hidden, OUTPUTS>>();
+  std::vector<int8_t> inputs(static_cast<std::size_t>(steps) * INPUTS);
+  for (int threads : {1, 2, 3, 8}) {
+    reference->init(rng);
+    *partitioned = *reference;
+    random_input(rng, inputs);
+    std::vector<int16_t> expected, actual;
+    bool same = true;
+    update_partitioned(
+        *partitioned, steps,
+        [&](int step) { return std::span<int8_t const>(&inputs[step * INPUTS], INPUTS); },
+        [&](int step) {
+          reference->update(std::span<int8_t const>(&inputs[step * INPUTS], INPUTS));
+          reference->get_output(expected);
+          partitioned->get_output(actual);
+          same = same && reference->s_hidden == partitioned->s_hidden &&
+                 reference->act_hidden == partitioned->act_hidden && expected == actual;
+        },
+        threads);
+    if (!same) {
+      std::printf("partitioned mismatch: hidden %d threads %d\n", hidden, threads);
+      return false;
+    }
+  }
+  return true;
+}
+
+// the fixed-point encoders against the float formulas they replace
+bool verify_encoders(int readings) {
+  std::mt19937 rng(23);
+  std::uniform_real_distribution<float> position(-2.0f, 3.0f), multiplier(0.1f, 5.0f);
+  FourierFeatures<INPUTS> features;
+  features.init(rng);
+  FourierEncoder<INPUTS> encoder;
+  encoder.init(features);
+
+  std::vector<float> x(readings), y(readings);
+  for (int n = 0; n < readings; ++n) {
+    x[n] = position(rng);
+    y[n] = position(rng);
+  }
+  std::vector<int8_t> actual(readings * INPUTS), expected(INPUTS);
+  // large multipliers must saturate rather than overflow. they also scale the sine table's error,
+  // so the tolerance grows with them
+  for (float m : {1.0f, multiplier(rng), multiplier(rng), 300.0f, -1000.0f}) {
+    encoder.set_multiplier(m);
+    encoder.encode(x, y, actual);
+    const float quantized = std::round(m * 256.0f) / 256.0f;
+    const int tolerance = 1 + static_cast<int>(std::abs(quantized) / 32.0f);
+    int worst = 0;
+    for (int n = 0; n < readings; ++n) {
+      features.encode(x[n], y[n], quantized, expected);
+      for (int i = 0; i < INPUTS; ++i)
+        worst = std::max(worst, std::abs(expected[i] - actual[n * INPUTS + i]));
+    }
+    if (worst > tolerance) {
+      std::printf("fourier encoder off by %d at multiplier %g\n", worst, m);
+      return false;
+    }
+  }
+
+  PopulationEncoder<8> distance(0.0f, 10.0f, 1.5f);
+  std::vector<int8_t> population(readings * 8);
+  distance.encode(x, population);
+  int worst = 0;
+  for (int n = 0; n < readings; ++n) {
+    for (int k = 0; k < 8; ++k) {
+      const float d = (x[n] - 10.0f * k / 7) / 1.5f;
+      const int exact = static_cast<int>(std::lround(127.0f * std::exp(-d * d / 2.0f)));
+      worst = std::max(worst, std::abs(exact - population[n * 8 + k]));
+    }
+  }
+  if (worst > 3) {
+    std::printf("population encoder off by %d\n", worst);
+    return false;
+  }
+  return true;
+}
+
+// randomized check of the vectorized input projection against the scalar fallback
+template <int inputs, int hidden> bool verify_projection(std::mt19937 &rng, int trials) {
+  std::uniform_int_distribution<int> dist(-128, 127);
+  std::vector<int8_t> w(hidden * inputs), input(inputs);
+  std::vector<int16_t> expected(hidden), actual(hidden);
+  for (int trial = 0; trial < trials; ++trial) {
+    for (auto &v : w)
+      v = static_cast<int8_t>(dist(rng));
+    for (auto &v : input)
+      v = static_cast<int8_t>(dist(rng));
+    for (int i = 0; i < hidden; ++i)
+      expected[i] = actual[i] = static_cast<int16_t>(dist(rng) * 256);
+    snn_simd::project_inputs_scalar(inputs, hidden, w.data(), input.data(), expected.data());
+    snn_simd::project_inputs<inputs, hidden>(w.data(), input.data(), actual.data());
+    if (expected != actual) {
+      std::printf("%s input projection mismatch: inputs %d hidden %d\n",
+                  snn_simd::name(snn_simd::active), inputs, hidden);
+      return false;
+    }
+  }
+  return true;
+}
+
+// runs check with the kernels switched to every SIMD ISA this CPU has, and to scalar if asked,
+// then goes back to the best one. isas lists the ones checked, so a verify never claims a kernel
+// it didn't run
+template <class Check> bool on_every_isa(bool scalar, std::string &isas, Check check) {
+  using snn_simd::Isa;
+  isas.clear();
+  bool ok = true;
+  for (Isa isa : {Isa::scalar, Isa::sse41, Isa::avx2, Isa::neon}) {
+    if (!ok || (isa == Isa::scalar && !scalar) || !snn_simd::use(isa))
+      continue;
+    ok = check();
+    isas += (isas.empty() ? "" : ", ") + std::string(snn_simd::name(isa));
+  }
+  snn_simd::use(snn_simd::detect());
+  return ok;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <int hidden, template <int> class Recurrent>
+void bench_sparse(const char *name, int fan_out, int steps) {
+  std::mt19937 rng(1);
+  SparseSNN<INPUTS, hidden, OUTPUTS, Recurrent> net;
+  net.init(rng, fan_out);
+  std::vector<int8_t> input(INPUTS);
+  random_input(rng, input);
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int step = 0; step < steps; ++step) {
+    net.update(input);
+  }
+  const double elapsed = seconds_since(start);
+  std::printf("sparse %s hidden %5d fan-out %3d: %.3e neuron-updates/s, %zu synapses in %zu "
+              "bytes\n",
+              name, hidden, fan_out, static_cast<double>(hidden) * steps / elapsed,
+              net.w_hidden_hidden.synapse_count(), net.w_hidden_hidden.bytes());
+}
+
+// one arena of a single shape, compiled-in or not
+void bench_arena(SNNShape shape, int size, int steps) {
+  std::mt19937 rng(1);
+  SNNArena arena;
+  arena.reserve(size, size * static_cast<std::size_t>(shape.hidden) *
+                          (shape.inputs + shape.hidden + shape.outputs));
+  for (int n = 0; n < size; ++n)
+    arena.init(arena.add(shape), rng);
+  std::vector<int8_t> input(arena.input_size());
+  random_input(rng, input);
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int step = 0; step < steps; ++step) {
+    arena.update(input);
+  }
+  const double elapsed = seconds_since(start);
+  std::printf("arena %-8s %6d networks, hidden %4d: %.3e neuron-updates/s\n",
+              arena.compiled(0) ? "compiled" : "generic", size, shape.hidden,
+              static_cast<double>(size) * shape.hidden * steps / elapsed);
+}
+
+// publishing every network's spikes and draining them on two consumer threads, against the
+// consumers each rescanning every activation array
+void bench_spike_stream(int size, int steps) {
+  std::mt19937 rng(1);
+  SNNArena arena;
+  for (int n = 0; n < size; ++n)
+    arena.init(arena.add({INPUTS, HIDDEN, OUTPUTS}), rng);
+  std::vector<int8_t> input(arena.input_size());
+  random_input(rng, input);
+  auto stream = std::make_unique<SpikeStream<>>();
+  const int consumers[] = {stream->subscribe(), stream->subscribe()};
+
+  std::atomic<bool> done{false};
+  std::atomic<uint64_t> consumed{0};
+  std::vector<std::thread> threads;
+  for (int consumer : consumers) {
+    threads.emplace_back([&, consumer] {
+      uint64_t count = 0;
+      const auto consume = [&](const SpikeEvent &) { ++count; };
+      while (!done.load(std::memory_order_acquire))
+        stream->poll(consumer, consume);
+      stream->poll(consumer, consume);
+      consumed.fetch_add(count, std::memory_order_relaxed);
+    });
+  }
+  double stepping = 0.0;
+  const auto start = std::chrono::steady_clock::now();
+  for (int step = 0; step < steps; ++step) {
+    const auto step_start = std::chrono::steady_clock::now();
+    arena.update(input);
+    stepping += seconds_since(step_start);
+    for (int n = 0; n < size; ++n)
+      stream->publish(n, step, arena.act(n));
+  }
+  done.store(true, std::memory_order_release);
+  for (auto &thread : threads)
+    thread.join();
+  const double publishing = seconds_since(start) - stepping;
+
+  // what two consumers spend rescanning instead
+  uint64_t rescanned = 0;
+  const auto scan_start = std::chrono::steady_clock::now();
+  for (int consumer = 0; consumer < 2; ++consumer) {
+    for (int n = 0; n < size; ++n) {
+      for (int i = 0; i < HIDDEN; ++i)
+        rescanned += arena.spiked(n, i);
+    }
+  }
+  const double rescan = seconds_since(scan_start) * steps;
+  std::printf("spike stream %6d networks: %.3e events/s published, %llu consumed, %llu dropped, "
+              "%.1f%% of stepping time vs %.1f%% to rescan (%llu spikes last step)\n",
+              size, (stream->published() + stream->dropped()) / publishing,
+              static_cast<unsigned long long>(consumed.load()),
+              static_cast<unsigned long long>(stream->dropped()), 100.0 * publishing / stepping,
+              100.0 * rescan / stepping, static_cast<unsigned long long>(rescanned / 2));
+}
+
+void bench_fitness(int size, int steps) {
+  std::mt19937 rng(1);
+  FourierFeatures<INPUTS> features;
+  features.init(rng);
+  const auto trajectory = fourier_trajectory(features, steps, 1.0f, rng);
+  std::vector<Network> genomes(size);
+  for (auto &genome : genomes)
+    genome.init(rng);
+
+  SNNFitnessHarness<INPUTS, HIDDEN, OUTPUTS> harness;
+  std::vector<SNNEvaluation<OUTPUTS>> results;
+  const auto start = std::chrono::steady_clock::now();
+  harness.evaluate(genomes, trajectory, results);
+  const double elapsed = seconds_since(start);
+  double rate = 0.0;
+  for (const auto &result : results)
+    rate += result.firing_rate(HIDDEN);
+  std::printf("fitness    %6d genomes x %d steps: %.3e network-steps/s, mean firing rate %.3f\n",
+              size, steps, harness.network_steps() / elapsed, rate / size);
+}
+
+// one generation is neuron-block crossover of two random parents plus mutation for every child
+void bench_reproduction(int size, int generations) {
+  using Pool = SNNGenomePool<INPUTS, HIDDEN, OUTPUTS>;
+  std::mt19937 rng(1);
+  auto parents = std::make_unique<Pool>(size);
+  auto children = std::make_unique<Pool>(size);
+  Network net;
+  for (int g = 0; g < size; ++g) {
+    net.init(rng);
+    parents->load(g, net);
+  }
+  const CounterRNG counter{rng()};
+  const MutationParams params;
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int generation = 0; generation < generations; ++generation) {
+#pragma omp parallel for schedule(static)
+    for (int g = 0; g < size; ++g) {
+      const uint64_t stream = static_cast<uint64_t>(generation) * size + g;
+      const uint64_t pick = counter(stream, ~uint64_t{0});
+      const int a = static_cast<int>((pick & 0xffffffff) * size >> 32);
+      const int b = static_cast<int>((pick >> 32) * size >> 32);
+      children->crossover_neurons(g, *parents, a, b, counter, stream);
+      children->mutate(g, params, counter, stream);
+    }
+    std::swap(parents, children);
+  }
+  const double elapsed = seconds_since(start);
+  std::printf("reproduce  %6d genomes: %.1f generations/s, %zu byte records\n", size,
+              generations / elapsed, static_cast<std::size_t>(Pool::STRIDE));
+}
+
+void bench_archive(int records) {
+  using Pool = SNNGenomePool<INPUTS, HIDDEN, OUTPUTS>;
+  const std::string path = temp_path("snn_bench.archive");
+  std::filesystem::remove(path);
+  std::filesystem::remove(path + ".index");
+  std::mt19937 rng(1);
+  Pool pool(1);
+  Network net;
+  net.init(rng);
+  pool.load(0, net);
+
+  GenomeArchive archive;
+  if (!archive.open(path, Pool::RECORD))
+    return;
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < records; ++r)
+    archive.append(pool.record(0), static_cast<float>(rng()) / 4294967296.0f, r / 1000);
+  archive.flush();
+  const double append = seconds_since(start);
+
+  std::vector<uint64_t> top;
+  start = std::chrono::steady_clock::now();
+  archive.top_k(100, top);
+  const double top_k = seconds_since(start);
+  std::printf("archive    %6d records of %d bytes: %.3e appends/s, top-100 in %.2f ms\n", records,
+              Pool::RECORD, records / append, top_k * 1000.0);
+  archive.close();
+  std::filesystem::remove(path);
+  std::filesystem::remove(path + ".index");
+}
+
+// time to record every network of an arena after each step, the encoded size against raw bitmaps,
+// and random reads of chunk-sized tick ranges
+void bench_spike_recorder(int size, int steps) {
+  const std::string path = temp_path("snn_bench.spikes");
+  std::mt19937 rng(1);
+  SNNArena arena;
+  for (int n = 0; n < size; ++n)
+    arena.init(arena.add({INPUTS, HIDDEN, OUTPUTS}), rng);
+  std::vector<int8_t> input(arena.input_size());
+  random_input(rng, input);
+
+  // the writer is meant to run on a core of its own. with only one, it is given its time outside
+  // the timed loops instead: a flush right after a chunk's last tick writes the same blocks
+  const bool one_core = std::thread::hardware_concurrency() < 2;
+  constexpr uint32_t CHUNK_TICKS = 1024;
+  SpikeRecorder recorder;
+  if (!recorder.open(path, size, HIDDEN, CHUNK_TICKS))
+    return;
+  double stepping = 0.0, recording = 0.0;
+  for (int step = 0; step < steps; ++step) {
+    auto start = std::chrono::steady_clock::now();
+    arena.update(input);
+    stepping += seconds_since(start);
+    start = std::chrono::steady_clock::now();
+    for (int n = 0; n < size; ++n)
+      recorder.record(n, step, arena.act(n));
+    recorder.end_tick();
+    recording += seconds_since(start);
+    if (one_core && step % CHUNK_TICKS == CHUNK_TICKS - 1)
+      recorder.flush();
+  }
+  recorder.flush();
+  const uint64_t bytes = recorder.bytes();
+  recorder.close();
+  const double raw = static_cast<double>(size) * spike_words(HIDDEN) * 8 * steps;
+
+  SpikeReader reader;
+  if (!reader.open(path))
+    return;
+  std::vector<SpikeReader::Spike> spikes;
+  constexpr int READS = 10000;
+  const auto start = std::chrono::steady_clock::now();
+  for (int k = 0; k < READS; ++k) {
+    const uint64_t begin = rng() % steps;
+    spikes.clear();
+    reader.read(rng() % size, begin, begin + reader.chunk_ticks(), spikes);
+  }
+  const double reading = seconds_since(start);
+  std::printf("spike recorder %6d networks: %.1f ns/network recorded, %.1f%% of stepping time%s, "
+              "%.2f bytes/tick/network (%.1fx smaller than bitmaps), %.3e chunk reads/s\n",
+              size, 1e9 * recording / (static_cast<double>(size) * steps),
+              100.0 * recording / stepping, one_core ? " (writer run untimed)" : "",
+              static_cast<double>(bytes) / (static_cast<double>(size) * steps), raw / bytes,
+              READS / reading);
+  std::filesystem::remove(path);
+  std::filesystem::remove(path + ".index");
+}
+
+// single network, with and without plasticity
+template <int hidden> void bench_stdp(int steps) {
+  std::mt19937 rng(1);
+  auto net = std::make_unique<SNN<INPUTS, hidden, OUTPUTS>>();
+  net->init(rng);
+  auto plastic = std::make_unique<SNN<INPUTS, hidden, OUTPUTS>>(*net);
+  auto stdp = std::make_unique<SNNPlasticity<INPUTS, hidden, OUTPUTS>>();
+  std::vector<int8_t> input(INPUTS);
+  random_input(rng, input);
+
+  auto start = std::chrono::steady_clock::now();
+  for (int step = 0; step < steps; ++step)
+    net->update(input);
+  const double fixed = seconds_since(start);
+  start = std::chrono::steady_clock::now();
+  int spikes = 0;
+  for (int step = 0; step < steps; ++step) {
+    plastic->update(input);
+    stdp->step(*plastic, input);
+    for (int i = 0; i < hidden; ++i)
+      spikes += plastic->spiked(i);
+  }
+  const double learning = seconds_since(start);
+  std::printf("stdp       hidden %4d: %.3e steps/s fixed, %.3e steps/s plastic, %.1f spikes/step\n",
+              hidden, steps / fixed, steps / learning, static_cast<double>(spikes) / steps);
+}
+
+// Fourier-encode one reading per creature, float reference vs fixed point
+void bench_encoder(int size, int ticks) {
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> position(0.0f, 1.0f);
+  FourierFeatures<INPUTS> features;
+  features.init(rng);
+  FourierEncoder<INPUTS> encoder;
+  encoder.init(features);
+  std::vector<float> x(size), y(size);
+  for (int n = 0; n < size; ++n) {
+    x[n] = position(rng);
+    y[n] = position(rng);
+  }
+  std::vector<int8_t> out(size * INPUTS);
+
+  auto start = std::chrono::steady_clock::now();
+  for (int tick = 0; tick < ticks; ++tick)
+    for (int n = 0; n < size; ++n)
+      features.encode(x[n], y[n], 1.0f, std::span<int8_t>(&out[n * INPUTS], INPUTS));
+  const double reference = seconds_since(start);
+  start = std::chrono::steady_clock::now();
+  for (int tick = 0; tick < ticks; ++tick)
+    encoder.encode(x, y, out);
+  const double fixed = seconds_since(start);
+  std::printf("encoder    %6d creatures: %.3e inputs/s float, %.3e inputs/s fixed point\n", size,
+              static_cast<double>(size) * INPUTS * ticks / reference,
+              static_cast<double>(size) * INPUTS * ticks / fixed);
+}
+
+template <int hidden, int weight_bits = 8> void bench_scalar(int size, int steps) {
+  std::mt19937 rng(1);
+  std::vector<SNN<INPUTS, hidden, OUTPUTS, weight_bits>> networks(size);
+  for (auto &net : networks)
+    net.init(rng);
+  std::vector<int8_t> input(size * INPUTS);
+  random_input(rng, input);
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int step = 0; step < steps; ++step) {
+    for (int n = 0; n < size; ++n) {
+      networks[n].update(std::span<int8_t const>(&input[n * INPUTS], INPUTS));
+    }
+  }
+  const double elapsed = seconds_since(start);
+  std::printf("scalar int%d %5d networks, hidden %4d: %.3e neuron-updates/s\n", weight_bits, size,
+              hidden, static_cast<double>(size) * hidden * steps / elapsed);
+}
+
+// sizes a hardware core: cycles per step on Fourier-driven dynamics, the tick rate one core reaches
+// at clock_hz, how many networks it can time-multiplex at tick_hz, and the weight BRAM it needs
+template <int hidden> void report_core_model(const SNNCoreConfig &config, double clock_hz,
+                                             double tick_hz, int steps) {
+  std::mt19937 rng(53);
+  auto net = std::make_unique<SNN<INPUTS, hidden, OUTPUTS>>();
+  net->init(rng);
+  FourierFeatures<INPUTS> features;
+  features.init(rng);
+  const auto trajectory = fourier_trajectory(features, steps, 2.0f, rng);
+  SNNCoreModel<INPUTS, hidden, OUTPUTS> core(config);
+  core.load(*net);
+  std::vector<int16_t> output;
+  for (int step = 0; step < steps; ++step) {
+    core.update(std::span<int8_t const>(&trajectory[step * INPUTS], INPUTS));
+    core.get_output(output);
+  }
+  const auto &stats = core.stats();
+  const double per_step = stats.cycles_per_step();
+  std::printf("core hidden %4d, %2d lanes, %2d-bit x%d ports: %7.1f cycles/step "
+              "(in %.0f, rec %.0f, fire %.0f, out %.0f), %.3e steps/s at %.0f MHz, "
+              "compute for %.0f networks at %.0f Hz, %d RAMB36 per network\n",
+              hidden, config.neurons_per_cycle, config.bram_width, config.bram_ports, per_step,
+              static_cast<double>(stats.input_cycles) / steps,
+              static_cast<double>(stats.recurrent_cycles) / steps,
+              static_cast<double>(stats.fire_cycles) / steps,
+              static_cast<double>(stats.output_cycles) / steps, stats.tick_rate(clock_hz),
+              clock_hz / 1e6, std::floor(stats.tick_rate(clock_hz) / tick_hz), tick_hz,
+              core.bram36());
+}
+
+template <const auto &weights> void bench_frozen(const char *name, int steps) {
+  std::mt19937 rng(1);
+  FrozenSNN<weights> frozen;
+  Network net;
+  thaw(weights, net);
+  FourierFeatures<INPUTS> features;
+  features.init(rng);
+  const auto trajectory = fourier_trajectory(features, 1024, 2.0f, rng);
+
+  const auto run = [&](auto &network) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int step = 0; step < steps; ++step)
+      network.update(std::span<int8_t const>(&trajectory[step % 1024 * INPUTS], INPUTS));
+    return seconds_since(start);
+  };
+  const double generic = run(net);
+  const double specialized = run(frozen);
+  std::printf("frozen %-6s %4d/%d synapses: %.3e steps/s vs %.3e steps/s for SNN::update\n", name,
+              FrozenSNN<weights>::synapses(), HIDDEN * (INPUTS + HIDDEN + OUTPUTS),
+              steps / specialized, steps / generic);
+}
+
+// trains a reservoir readout to reconstruct the current inputs from the spikes, then checks it on a
+// held-out run
+template <int hidden> void report_readout(int steps, double ridge) {
+  std::mt19937 rng(67);
+  auto net = std::make_unique<SNN<INPUTS, hidden, OUTPUTS>>();
+  net->init(rng);
+  FourierFeatures<INPUTS> features;
+  features.init(rng);
+  const auto train = fourier_trajectory(features, steps, 2.0f, rng);
+  const auto test = fourier_trajectory(features, steps, 2.0f, rng);
+  auto trainer = std::make_unique<SNNReadoutTrainer<INPUTS, hidden, OUTPUTS>>();
+
+  std::vector<float> target(OUTPUTS);
+  const auto start = std::chrono::steady_clock::now();
+  for (int step = 0; step < steps; ++step) {
+    const std::span<int8_t const> input(&train[step * INPUTS], INPUTS);
+    net->update(input);
+    std::copy_n(input.begin(), OUTPUTS, target.begin());
+    trainer->record(*net, target);
+  }
+  const auto report = trainer->solve(ridge, *net);
+  const double elapsed = seconds_since(start);
+
+  net->clear();
+  std::vector<int16_t> output;
+  double error = 0.0, power = 0.0;
+  for (int step = 0; step < steps; ++step) {
+    const std::span<int8_t const> input(&test[step * INPUTS], INPUTS);
+    net->update(input);
+    net->get_output(output);
+    for (int j = 0; j < OUTPUTS; ++j) {
+      error += (output[j] - input[j]) * (output[j] - input[j]);
+      power += input[j] * input[j];
+    }
+  }
+  std::printf("readout hidden %4d, ridge %g: train rmse %.2f float, %.2f int8 (weight error %.3f, "
+              "%d clipped), held-out rmse %.2f of %.2f, %.3f s for %d steps\n",
+              hidden, ridge, report.rmse, report.quantized_rmse, report.weight_error,
+              report.clipped, std::sqrt(error / (static_cast<double>(steps) * OUTPUTS)),
+              std::sqrt(power / (static_cast<double>(steps) * OUTPUTS)), elapsed, steps);
+}
+
+template <int hidden> void bench_partitioned(int threads, int steps) {
+  std::mt19937 rng(1);
+  auto net = std::make_unique<SNN<INPUTS, hidden, OUTPUTS>>();
+  net->init(rng);
+  std::vector<int8_t> input(INPUTS);
+  random_input(rng, input);
+
+  const auto start = std::chrono::steady_clock::now();
+  long spikes = 0;
+  update_partitioned(
+      *net, steps, [&](int) { return std::span<int8_t const>(input); },
+      [&](int) {
+        for (auto word : net->act_hidden)
+          spikes += std::popcount(word);
+      },
+      threads);
+  const double elapsed = seconds_since(start);
+  std::printf("partitioned hidden %5d, %2d threads: %.3e neuron-updates/s, %.1f steps/s, "
+              "firing rate %.3f\n",
+              hidden, threads, static_cast<double>(hidden) * steps / elapsed, steps / elapsed,
+              static_cast<double>(spikes) / (static_cast<double>(hidden) * steps));
+}
+
+// a world where idle_percent of the blocks see constant input, with networks that rest without
+// input. effective throughput counts skipped networks as updated
+void bench_quiescence(int size, int idle_percent, int steps) {
+  std::mt19937 rng(1);
+  std::vector<Network> nets(size);
+  for (auto &net : nets) {
+    net.init(rng);
+    for (auto &b : net.b_hidden)
+      b /= 2;
+  }
+  // a few input frames, made before timing. active networks see a new frame every step, idle ones
+  // always read zeros
+  const int active = size - size / 32 * idle_percent / 100 * 32;
+  std::vector<std::vector<int8_t>> frames(8, std::vector<int8_t>(size * INPUTS, 0));
+  for (auto &frame : frames) {
+    for (int k = 0; k < active * INPUTS; ++k)
+      frame[k] = static_cast<int8_t>(rng() % 64);
+  }
+
+  // the same workload with and without skipping, so the check's cost on active blocks shows
+  double rate[2] = {};
+  double skipped = 0.0;
+  for (const bool skip : {true, false}) {
+    Population population(size);
+    population.set_skip_quiescent(skip);
+    for (int n = 0; n < size; ++n)
+      population.set_network(n, nets[n]);
+    const auto start = std::chrono::steady_clock::now();
+    for (int step = 0; step < steps; ++step)
+      population.update(frames[step % frames.size()]);
+    const double elapsed = seconds_since(start);
+    const double total =
+        static_cast<double>(population.neuron_updates() + population.skipped_updates());
+    rate[skip ? 0 : 1] = total / elapsed;
+    if (skip)
+      skipped = 100.0 * population.skipped_updates() / total;
+  }
+  std::printf("quiescence %6d networks, %3d%% idle: %.3e effective neuron-updates/s, "
+              "%.3e without skipping, %.1f%% skipped\n",
+              size, idle_percent, rate[0], rate[1], skipped);
+}
+
+void bench_population(int size, int steps) {
+  std::mt19937 rng(1);
+  Population population(size);
+  Network net;
+  for (int n = 0; n < size; ++n) {
+    net.init(rng);
+    population.set_network(n, net);
+  }
+  std::vector<int8_t> input(size * INPUTS);
+  random_input(rng, input);
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int step = 0; step < steps; ++step) {
+    population.update(input);
+  }
+  const double elapsed = seconds_since(start);
+  std::printf("population %6d networks, hidden %4d: %.3e neuron-updates/s\n", size, HIDDEN,
+              population.neuron_updates() / elapsed);
+}
+
+// one point of the throughput sweep. rates are per second of stepping (update then get_output on
+// every network), bytes_per_step is per network step
+struct SweepResult {
+  std::string kernel;
+  SNNShape shape;
+  double target_rate;
+  int networks;
+  int steps;
+  double firing_rate; // measured spikes per neuron update
+  double neuron_updates;
+  double synaptic_events;
+  double bytes_per_step;
+};
+
+// what one network step reads and writes. synaptic events are the weights a step applies: every
+// input weight, plus the recurrent and output fan-out of each spike. bytes are the weights and
+// neuron state a kernel touches to do it, so dense and sparse kernels are comparable by events but
+// not by bytes
+struct StepCost {
+  double synaptic_events;
+  double bytes;
+};
+
+// sweep points run about this many neuron updates, on at most this many bytes of weights
+constexpr double SWEEP_NEURON_UPDATES = 2e7;
+constexpr double SWEEP_WEIGHT_BYTES = 32 << 20;
+constexpr int SWEEP_NEURONS = 1 << 17;
+constexpr int SWEEP_FRAMES = 8;
+
+// times steps calls of step(t), then steps a quarter as many more untimed, summing spikes() (the
+// spikes of the last step over every network) for the firing rate. cost(s) is a network step's
+// cost at s spikes
+template <typename Step, typename Spikes, typename Cost>
+SweepResult sweep_point(std::string kernel, SNNShape shape, double target_rate, int networks,
+                        int steps, Step &&step, Spikes &&spikes, Cost &&cost) {
+  const auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < steps; ++t)
+    step(t);
+  const double elapsed = seconds_since(start);
+
+  const int probe = std::max(steps / 4, 1);
+  double spike_count = 0.0;
+  for (int t = steps; t < steps + probe; ++t) {
+    step(t);
+    spike_count += static_cast<double>(spikes());
+  }
+  const double per_step = spike_count / (static_cast<double>(networks) * probe);
+  const StepCost step_cost = cost(per_step);
+  const double network_steps = static_cast<double>(networks) * steps;
+  return {std::move(kernel),
+          shape,
+          target_rate,
+          networks,
+          steps,
+          per_step / shape.hidden,
+          network_steps * shape.hidden / elapsed,
+          network_steps * step_cost.synaptic_events / elapsed,
+          step_cost.bytes};
+}
+
+std::size_t count_bits(std::span<const uint64_t> act) {
+  std::size_t count = 0;
+  for (auto word : act)
+    count += std::popcount(word);
+  return count;
+}
+
+// probe runs for bias calibration: this many networks, stepped this many ticks, the spikes of the
+// second half counted
+constexpr int CALIBRATION_NETWORKS = 16;
+constexpr int CALIBRATION_STEPS = 64;
+
+// every neuron's bias is mean times its own jitter. recurrent and input drive make the firing rate
+// of a shape hard to predict from the bias, so the mean is bisected against probe(mean), the rate
+// a short run measures, which rises with the bias
+template <typename Probe> double calibrate_bias(double target_rate, Probe &&probe) {
+  double low = 0.0, high = 255.0;
+  for (int k = 0; k < 8; ++k) {
+    const double mean = (low + high) / 2.0;
+    (probe(mean) < target_rate ? low : high) = mean;
+  }
+  return (low + high) / 2.0;
+}
+
+// sweep points whose measured rate is this far off the target couldn't be calibrated to it, e.g.
+// because input drive alone fires the shape faster, and are flagged
+bool on_target(const SweepResult &r) {
+  return r.firing_rate >= r.target_rate / 2.0 && r.firing_rate <= r.target_rate * 2.0;
+}
+
+// every kernel on one shape. networks get int4 SNN::init weights, with biases calibrated so they
+// fire at about target_rate (each neuron's bias jittered by 20%), and cycle through a few random
+// input frames so nothing settles. the int8 kernels step to_int8 copies of the int4 networks, so
+// all dense kernels run identical dynamics; the sparse kernel has its own weights and calibration
+template <int inputs, int hidden, int outputs>
+void sweep_shape(double target_rate, std::vector<SweepResult> &results) {
+  constexpr SNNShape SHAPE{inputs, hidden, outputs};
+  constexpr int WORDS = spike_words(hidden);
+  constexpr double WEIGHTS = static_cast<double>(hidden) * (inputs + hidden + outputs);
+  const int networks = std::max(
+      1, std::min(SWEEP_NEURONS / hidden, static_cast<int>(SWEEP_WEIGHT_BYTES / WEIGHTS)));
+  const double neurons = static_cast<double>(networks) * hidden;
+  const int steps = std::max(20, static_cast<int>(SWEEP_NEURON_UPDATES / neurons));
+
+  std::mt19937 rng(1);
+  std::vector<std::vector<int8_t>> frames(SWEEP_FRAMES, std::vector<int8_t>(networks * inputs));
+  for (auto &frame : frames)
+    random_input(rng, frame);
+  const auto input = [&](int t, int n) {
+    return std::span<int8_t const>(&frames[t % SWEEP_FRAMES][n * inputs], inputs);
+  };
+  std::vector<double> jitter(static_cast<std::size_t>(networks) * hidden);
+  std::uniform_real_distribution<double> dist_jitter(0.8, 1.2);
+  for (auto &j : jitter)
+    j = dist_jitter(rng);
+  const auto set_bias = [&](auto &net, int n, double mean) {
+    for (int i = 0; i < hidden; ++i) {
+      const double bias = mean * jitter[static_cast<std::size_t>(n) * hidden + i];
+      net.b_hidden[i] = static_cast<uint8_t>(std::clamp(std::lround(bias), 0l, 255l));
+    }
+  };
+  // firing rate of the first few networks over a short run at a mean bias, from a cleared state
+  const auto probe = [&](auto &nets) {
+    return [&](double mean) {
+      const int count = std::min(networks, CALIBRATION_NETWORKS);
+      double spikes = 0.0;
+      for (int n = 0; n < count; ++n) {
+        auto &net = nets[n];
+        set_bias(net, n, mean);
+        net.clear();
+        for (int t = 0; t < CALIBRATION_STEPS; ++t) {
+          net.update(input(t, n));
+          if (t >= CALIBRATION_STEPS / 2)
+            spikes += static_cast<double>(count_bits(net.act_hidden));
+        }
+        net.clear();
+      }
+      return spikes / (static_cast<double>(count) * hidden * (CALIBRATION_STEPS / 2));
+    };
+  };
+
+  std::vector<SNN<inputs, hidden, outputs, 4>> base4(networks);
+  for (auto &net : base4)
+    net.init(rng);
+  const double mean_bias = calibrate_bias(target_rate, probe(base4));
+  std::vector<SNN<inputs, hidden, outputs>> base(networks);
+  for (int n = 0; n < networks; ++n) {
+    set_bias(base4[n], n, mean_bias);
+    to_int8(base4[n], base[n]);
+  }
+
+  // leak, bias and state read plus state written, and the spike bitmap read and written
+  constexpr double NEURON_BYTES = 3.0 * hidden + 2.0 * WORDS * sizeof(uint64_t);
+  const auto dense_cost = [](double weight_bytes) {
+    return [weight_bytes](double spikes) {
+      const double events = hidden * inputs + spikes * (hidden + outputs);
+      return StepCost{events, events * weight_bytes + NEURON_BYTES};
+    };
+  };
+  std::vector<int16_t> output;
+
+  {
+    auto nets = base;
+    results.push_back(sweep_point(
+        "snn", SHAPE, target_rate, networks, steps,
+        [&](int t) {
+          for (int n = 0; n < networks; ++n) {
+            nets[n].update(input(t, n));
+            nets[n].get_output(output);
+          }
+        },
+        [&] {
+          std::size_t count = 0;
+          for (const auto &net : nets)
+            count += count_bits(net.act_hidden);
+          return count;
+        },
+        dense_cost(1.0)));
+  }
+  {
+    auto nets = base4;
+    results.push_back(sweep_point(
+        "snn_int4", SHAPE, target_rate, networks, steps,
+        [&](int t) {
+          for (int n = 0; n < networks; ++n) {
+            nets[n].update(input(t, n));
+            nets[n].get_output(output);
+          }
+        },
+        [&] {
+          std::size_t count = 0;
+          for (const auto &net : nets)
+            count += count_bits(net.act_hidden);
+          return count;
+        },
+        dense_cost(0.5)));
+  }
+  // every lane multiplies the whole recurrent matrix by its activations, and a block of 32 lanes
+  // is hidden^2 * 32 bytes, so only small shapes
+  if constexpr (hidden <= 256) {
+    SNNPopulation<inputs, hidden, outputs> population(networks);
+    for (int n = 0; n < networks; ++n)
+      population.set_network(n, base[n]);
+    std::vector<uint32_t> counts(networks);
+    results.push_back(sweep_point(
+        "population", SHAPE, target_rate, networks, steps,
+        [&](int t) {
+          population.update(frames[t % SWEEP_FRAMES]);
+          population.get_output(output);
+        },
+        [&] {
+          std::fill(counts.begin(), counts.end(), 0);
+          population.count_spikes(counts);
+          return std::accumulate(counts.begin(), counts.end(), std::size_t{0});
+        },
+        [](double spikes) {
+          return StepCost{hidden * inputs + spikes * (hidden + outputs),
+                          WEIGHTS + 3.0 * hidden + 2.0 * hidden};
+        }));
+  }
+  {
+    SNNArena arena;
+    arena.reserve(networks, static_cast<std::size_t>(networks * WEIGHTS));
+    for (int n = 0; n < networks; ++n)
+      arena.load(arena.add(SHAPE), base[n]);
+    results.push_back(sweep_point(
+        arena.compiled(0) ? "arena" : "arena_generic", SHAPE, target_rate, networks, steps,
+        [&](int t) {
+          arena.update(frames[t % SWEEP_FRAMES]);
+          for (int n = 0; n < networks; ++n)
+            arena.get_output(n, output);
+        },
+        [&] {
+          std::size_t count = 0;
+          for (int n = 0; n < networks; ++n) {
+            for (auto word : arena.act(n))
+              count += std::popcount(word);
+          }
+          return count;
+        },
+        dense_cost(1.0)));
+  }
+  {
+    // an eighth of the recurrent synapses, at the same target rate
+    constexpr int FAN_OUT = std::max(hidden / 8, 1);
+    std::vector<SparseSNN<inputs, hidden, outputs, CSRWeights>> nets(networks);
+    for (auto &net : nets)
+      net.init(rng, FAN_OUT);
+    const double sparse_bias = calibrate_bias(target_rate, probe(nets));
+    for (int n = 0; n < networks; ++n)
+      set_bias(nets[n], n, sparse_bias);
+    const double row_bytes = static_cast<double>(nets[0].w_hidden_hidden.bytes()) / hidden;
+    results.push_back(sweep_point(
+        "sparse_csr", SHAPE, target_rate, networks, steps,
+        [&](int t) {
+          for (int n = 0; n < networks; ++n) {
+            nets[n].update(input(t, n));
+            nets[n].get_output(output);
+          }
+        },
+        [&] {
+          std::size_t count = 0;
+          for (const auto &net : nets)
+            count += count_bits(net.act_hidden);
+          return count;
+        },
+        [row_bytes](double spikes) {
+          return StepCost{hidden * inputs + spikes * (FAN_OUT + outputs),
+                          hidden * inputs + spikes * (row_bytes + outputs) + NEURON_BYTES};
+        }));
+  }
+}
+
+void print_sweep(const SweepResult &r) {
+  std::printf("sweep %-13s %3d-%4d-%2d rate %.2f: %5d networks, firing %.3f, "
+              "%.3e neuron-updates/s, %.3e synaptic-events/s, %.0f bytes/step%s\n",
+              r.kernel.c_str(), r.shape.inputs, r.shape.hidden, r.shape.outputs, r.target_rate,
+              r.networks, r.firing_rate, r.neuron_updates, r.synaptic_events, r.bytes_per_step,
+              on_target(r) ? "" : " (off target)");
+}
+
+// one result per line, so runs from two commits can be compared with diff or jq
+bool write_sweep_json(const char *path, const std::vector<SweepResult> &results) {
+  std::FILE *file = std::fopen(path, "w");
+  if (file == nullptr)
+    return false;
+  std::fprintf(file, "{\n  \"isa\": \"%s\",\n  \"threads\": %d,\n  \"results\": [\n",
+               snn_simd::name(snn_simd::active), omp_get_max_threads());
+  for (std::size_t k = 0; k < results.size(); ++k) {
+    const SweepResult &r = results[k];
+    std::fprintf(file,
+                 "    {\"kernel\": \"%s\", \"inputs\": %d, \"hidden\": %d, \"outputs\": %d, "
+                 "\"target_rate\": %.3f, \"networks\": %d, \"steps\": %d, \"firing_rate\": %.6f, "
+                 "\"neuron_updates_per_s\": %.6e, \"synaptic_events_per_s\": %.6e, "
+                 "\"bytes_per_step\": %.1f, \"on_target\": %s}%s\n",
+                 r.kernel.c_str(), r.shape.inputs, r.shape.hidden, r.shape.outputs,
+                 r.target_rate, r.networks, r.steps, r.firing_rate, r.neuron_updates,
+                 r.synaptic_events, r.bytes_per_step, on_target(r) ? "true" : "false",
+                 k + 1 < results.size() ? "," : "");
+  }
+  std::fprintf(file, "  ]\n}\n");
+  return std::fclose(file) == 0;
+}
+
+// sizes from the default brain up to one large network, at low, default and high firing rates
+std::vector<SweepResult> sweep() {
+  std::vector<SweepResult> results;
+  for (double rate : {0.01, 0.05, 0.25}) {
+    sweep_shape<16, 32, 8>(rate, results);
+    sweep_shape<16, 64, 8>(rate, results);
+    sweep_shape<32, 128, 16>(rate, results);
+    sweep_shape<64, 256, 16>(rate, results);
+    sweep_shape<64, 1024, 16>(rate, results);
+  }
+  return results;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  // --sweep runs the throughput sweep instead of the fixed benchmarks, --json also writes its
+  // results to a file
+  bool run_sweep = false;
+  const char *json = nullptr;
+  for (int k = 1; k < argc; ++k) {
+    const std::string arg = argv[k];
+    if (arg == "--sweep") {
+      run_sweep = true;
+    } else if (arg == "--json" && k + 1 < argc) {
+      run_sweep = true;
+      json = argv[++k];
+    } else {
+      std::printf("usage: %s [--sweep] [--json <path>]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  if (!verify_population(100, 200)) {
+    return 1;
+  }
+  std::printf("verify: population matches SNN::update\n");
+  if (!verify_quiescence(200, 600)) {
+    return 1;
+  }
+  std::printf("verify: quiescent blocks are skipped without changing results\n");
+  if (!verify_bitplanes<HIDDEN>(500) || !verify_bitplanes<200>(500)) {
+    return 1;
+  }
+  std::printf("verify: bit-plane recurrent matches SNN::update\n");
+  std::mt19937 rng(7);
+  std::string isas;
+  if (!on_every_isa(false, isas, [&] {
+        return verify_projection<INPUTS, HIDDEN>(rng, 1000) && verify_projection<7, 5>(rng, 1000) &&
+               verify_projection<8, 3>(rng, 1000) && verify_projection<37, 19>(rng, 1000) &&
+               verify_projection<256, 64>(rng, 100);
+      })) {
+    return 1;
+  }
+  if (isas.empty())
+    std::printf("verify: no SIMD ISA on this CPU, input projection only runs scalar\n");
+  else
+    std::printf("verify: input projection matches scalar on %s\n", isas.c_str());
+  if (!verify_sparse<HIDDEN, CSRWeights>(500) || !verify_sparse<300, CSRWeights>(500) ||
+      !verify_sparse<300, ELLWeights>(500)) {
+    return 1;
+  }
+  std::printf("verify: sparse CSR/ELL matches SNN::update\n");
+  if (!verify_arena(500)) {
+    return 1;
+  }
+  std::printf("verify: arena matches SNN::update\n");
+  if (!verify_spike_stream(64, 300)) {
+    return 1;
+  }
+  std::printf("verify: spike stream delivers every published event to every consumer\n");
+  if (!verify_fitness(70, 300)) {
+    return 1;
+  }
+  std::printf("verify: fitness harness matches SNN::update\n");
+  if (!verify_genetics()) {
+    return 1;
+  }
+  std::printf("verify: genetic operators\n");
+  if (!verify_archive()) {
+    return 1;
+  }
+  std::printf("verify: genome archive round trip and top_k\n");
+  if (!verify_spike_recorder(50, 2000)) {
+    return 1;
+  }
+  std::printf("verify: spike recordings read back for any tick range\n");
+  if (!verify_stdp<HIDDEN>(500) || !verify_stdp<130>(500)) {
+    return 1;
+  }
+  std::printf("verify: STDP matches the all-pairs rule\n");
+  if (!on_every_isa(true, isas, [] {
+        return verify_int4<INPUTS, HIDDEN>(500) && verify_int4<37, 130>(500) &&
+               verify_int4<64, 256>(300);
+      })) {
+    return 1;
+  }
+  std::printf("verify: int4 kernels match int8 on %s\n", isas.c_str());
+  if (!verify_encoders(2000)) {
+    return 1;
+  }
+  std::printf("verify: sensory encoders match float\n");
+  if (!verify_core_model<INPUTS, HIDDEN>(300) || !verify_core_model<37, 130>(200)) {
+    return 1;
+  }
+  std::printf("verify: hardware core model matches SNN::update\n");
+  if (!verify_frozen<FROZEN_DENSE>(1000) || !verify_frozen<FROZEN_SPARSE>(1000)) {
+    return 1;
+  }
+  std::printf("verify: frozen networks match SNN::update\n");
+  if (!verify_readout(2000)) {
+    return 1;
+  }
+  std::printf("verify: readout trainer recovers a known readout\n");
+  if (!verify_partitioned<HIDDEN>(300) || !verify_partitioned<300>(300) ||
+      !verify_partitioned<1000>(100)) {
+    return 1;
+  }
+  std::printf("verify: partitioned stepping matches SNN::update\n");
+
+  if (run_sweep) {
+    const auto results = sweep();
+    for (const auto &result : results)
+      print_sweep(result);
+    if (json != nullptr && !write_sweep_json(json, results)) {
+      std::printf("could not write %s\n", json);
+      return 1;
+    }
+    return 0;
+  }
+
+  for (int size : {256, 4096}) {
+    bench_scalar<HIDDEN>(size, 200);
+    bench_population(size, 200);
+  }
+  for (int idle : {0, 50, 90}) {
+    bench_quiescence(4096, idle, 300);
+  }
+  bench_encoder(10000, 100);
+  bench_fitness(10000, 1000);
+  bench_reproduction(10000, 20);
+  bench_archive(100000);
+  bench_stdp<256>(20000);
+  bench_stdp<1024>(5000);
+  bench_arena({INPUTS, HIDDEN, OUTPUTS}, 4096, 200);
+  bench_arena({INPUTS, HIDDEN + 1, OUTPUTS}, 4096, 200);
+  bench_spike_stream(4096, 200);
+  bench_spike_recorder(4096, 2000);
+  // recurrent cost scales with spikes, so large sparse networks should not be quadratic
+  bench_scalar<256>(64, 200);
+  bench_scalar<256, 4>(64, 200);
+  bench_scalar<1024>(16, 200);
+  bench_scalar<1024, 4>(16, 200);
+  // one large network, split over a thread team
+  bench_scalar<4096>(1, 100);
+  for (int threads : {1, 2, 4, 8}) {
+    bench_partitioned<4096>(threads, 100);
+  }
+  bench_frozen<FROZEN_DENSE>("dense", 1000000);
+  bench_frozen<FROZEN_SPARSE>("sparse", 1000000);
+  report_readout<HIDDEN>(20000, 1.0);
+  report_readout<256>(20000, 1.0);
+  compare_int4<HIDDEN>(5000);
+  compare_int4<256>(2000);
+  bench_sparse<4096, CSRWeights>("csr", 32, 200);
+  bench_sparse<4096, ELLWeights>("ell", 32, 200);
+  bench_sparse<16384, CSRWeights>("csr", 64, 100);
+  // hardware sizing at 200 MHz for a 60 Hz tick
+  for (const SNNCoreConfig config :
+       {SNNCoreConfig{1, 36, 1}, SNNCoreConfig{4, 36, 2}, SNNCoreConfig{8, 72, 2}}) {
+    report_core_model<HIDDEN>(config, 200e6, 60.0, 2000);
+    report_core_model<256>(config, 200e6, 60.0, 500);
+  }
+  return 0;
+}
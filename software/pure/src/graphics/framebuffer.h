@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
 #include <stdexcept>
 #include <vector>
@@ -15,11 +16,38 @@ struct Pixel {
       : r(R), g(G), b(B), a(A) {}
 };
 
+// LINEAR stores rows one after another. TILED stores 8x8-pixel tiles one after another (tiles in
+// row-major order, pixels row-major within a tile), so small or tall primitives touch far fewer
+// cache lines. the texture upload converts back to linear through linear_data().
+enum class FramebufferLayout { LINEAR, TILED };
+
 class Framebuffer {
 public:
-  Framebuffer(int width, int height) : m_width(width), m_height(height), fb(width * height) {}
+  static constexpr int TILE_SHIFT = 3;
+  static constexpr int TILE_SIZE = 1 << TILE_SHIFT;
+  static constexpr int TILE_MASK = TILE_SIZE - 1;
+
+  Framebuffer(int width, int height, FramebufferLayout layout = FramebufferLayout::LINEAR)
+      : m_width(width), m_height(height), m_layout(layout),
+        m_tile_cols((width + TILE_MASK) >> TILE_SHIFT),
+        fb(layout == FramebufferLayout::TILED
+               ? m_tile_cols * ((height + TILE_MASK) >> TILE_SHIFT) * TILE_SIZE * TILE_SIZE
+               : width * height) {}
+
+  // storage index of pixel (x, y)
+  std::size_t offset(int x, int y) const {
+    if (m_layout == FramebufferLayout::TILED) {
+      return tiled_offset(x, y, m_tile_cols);
+    }
+    return y * m_width + x;
+  }
+
+  static std::size_t tiled_offset(int x, int y, int tile_cols) {
+    const int tile = (y >> TILE_SHIFT) * tile_cols + (x >> TILE_SHIFT);
+    return (tile << (2 * TILE_SHIFT)) + ((y & TILE_MASK) << TILE_SHIFT) + (x & TILE_MASK);
+  }
 
-  // non-const [] returns a Pixel reference
+  // non-const [] returns a Pixel reference. index is a storage index (see offset)
   Pixel &operator[](std::size_t index) {
     return fb.at(index); // bounds checking
   }
@@ -31,25 +59,26 @@ public:
 
   // 2D access
   Pixel &at(int x, int y) {
-    return fb.at(y * m_width + x);
+    return fb.at(offset(x, y));
   }
 
   void set_safe(int x, int y, const Pixel &px) {
     if (x >= 0 && x < m_width && y >= 0 && y < m_height) {
-      fb.at(y * m_width + x) = px;
+      fb.at(offset(x, y)) = px;
     }
   }
 
   void get_safe(int x, int y, Pixel &px) const {
     if (x >= 0 && x < m_width && y >= 0 && y < m_height) {
-      px = fb.at(y * m_width + x);
+      px = fb.at(offset(x, y));
     }
   }
 
   const Pixel &at(int x, int y) const {
-    return fb.at(y * m_width + x);
+    return fb.at(offset(x, y));
   }
 
+  // raw storage, in this framebuffer's layout
   Pixel *data() {
     return fb.data();
   }
@@ -57,14 +86,41 @@ public:
     return fb.data();
   }
 
+  // row-major pixels with a stride of width(), e.g. for texture upload. free for LINEAR, TILED
+  // framebuffers are converted into an internal scratch buffer.
+  const Pixel *linear_data() {
+    if (m_layout == FramebufferLayout::LINEAR) {
+      return fb.data();
+    }
+    linear.resize(m_width * m_height);
+    for (int y = 0; y < m_height; ++y) {
+      Pixel *out = linear.data() + y * m_width;
+      for (int x = 0; x < m_width; x += TILE_SIZE) {
+        const Pixel *in = fb.data() + tiled_offset(x, y, m_tile_cols);
+        std::copy(in, in + std::min(TILE_SIZE, m_width - x), out + x);
+      }
+    }
+    return linear.data();
+  }
+
   int width() const {
     return m_width;
   }
   int height() const {
     return m_height;
   }
+  FramebufferLayout layout() const {
+    return m_layout;
+  }
+  // number of tiles per tile row (TILED only)
+  int tile_cols() const {
+    return m_tile_cols;
+  }
 
 private:
   int m_width, m_height;
+  FramebufferLayout m_layout;
+  int m_tile_cols;
   std::vector<Pixel> fb;
+  std::vector<Pixel> linear;
 };
@@ -1,21 +1,14 @@
 #include "gpu.h"
 #include <algorithm>
+#include <array>
+#include <cmath>
 #include <limits>
+#include <utility>
 
 constexpr int FRAME_READ_DELAY = 3; // used for alpha blending
 
 namespace gpu {
 
-int render(const Rect &instr, Framebuffer &fb);
-int render(const Circle &instr, Framebuffer &fb);
-int render(const Line &instr, Framebuffer &fb);
-
-int render(const Instruction &instr, Framebuffer &fb) {
-  return std::visit([&fb](const auto& instruction) -> int {
-    return render(instruction, fb);
-  }, instr);
-}
-
 // OpenGL-style alpha blending: GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA
 // formula: final = source.rgb * source.a + dest.rgb * (1 - source.a)
 //          final.a = source.a + dest.a * (1 - source.a)
@@ -35,90 +28,162 @@ Pixel alpha_blend(const Pixel &source, const Pixel &dest) {
       src_alpha + (dest.a * inv_src_alpha) / max_alpha);
 }
 
-int render(const Rect &instr, Framebuffer &fb) {
-  // optimization: if source is fully transparent, no need to render
-  if (instr.color.a == 0)
-    return 0;
+namespace {
 
-  // clamp rectangle bounds to framebuffer
-  auto x_start = std::max(instr.pos[0], std::int16_t{0});
-  auto x_end = std::min(static_cast<std::int16_t>(instr.pos[0] + instr.size[0]),
-                        static_cast<std::int16_t>(fb.width()));
-  auto y_start = std::max(instr.pos[1], std::int16_t{0});
-  auto y_end = std::min(static_cast<std::int16_t>(instr.pos[1] + instr.size[1]),
-                        static_cast<std::int16_t>(fb.height()));
+// every kernel is instantiated for each combination of these, so the choice between them is made
+// once per instruction instead of once per pixel
+enum class BlendMode { REPLACE, ALPHA, COUNT };
+enum class PixelFormat { RGBA8888, COUNT };
 
-  // optimization: if source is fully opaque, we can skip blending
-  if (instr.color.a == std::numeric_limits<std::uint8_t>::max()) {
-    for (auto y = y_start; y < y_end; ++y) {
-      for (auto x = x_start; x < x_end; ++x) {
-        fb.at(x, y) = instr.color;
-      }
-    }
+constexpr std::size_t SHAPE_COUNT = std::variant_size_v<Instruction>;
+constexpr std::size_t BLEND_MODE_COUNT = static_cast<std::size_t>(BlendMode::COUNT);
+constexpr std::size_t PIXEL_FORMAT_COUNT = static_cast<std::size_t>(PixelFormat::COUNT);
+constexpr std::size_t LAYOUT_COUNT = 2; // FramebufferLayout::LINEAR, FramebufferLayout::TILED
+
+template <BlendMode mode, PixelFormat format> inline void store(Pixel &dest, const Pixel &color) {
+  static_assert(format == PixelFormat::RGBA8888, "no store for this pixel format");
+  if constexpr (mode == BlendMode::REPLACE) {
+    dest = color;
+  } else {
+    dest = alpha_blend(color, dest);
+  }
+}
+
+template <FramebufferLayout layout, typename FB> inline auto &pixel_at(FB &fb, int x, int y) {
+  if constexpr (layout == FramebufferLayout::LINEAR) {
+    return fb.data()[y * fb.width() + x];
+  } else {
+    return fb.data()[Framebuffer::tiled_offset(x, y, fb.tile_cols())];
   }
-  // standard alpha blending
-  else {
-    for (auto y = y_start; y < y_end; ++y) {
-      for (auto x = x_start; x < x_end; ++x) {
-        const Pixel existing = fb.at(x, y);
-        fb.at(x, y) = alpha_blend(instr.color, existing);
+}
+
+// writes pixels [x_start, x_end) of row y
+template <BlendMode mode, PixelFormat format, FramebufferLayout layout>
+inline void fill_span(Framebuffer &fb, int y, int x_start, int x_end, const Pixel &color) {
+  if constexpr (layout == FramebufferLayout::LINEAR) {
+    Pixel *row = fb.data() + y * fb.width();
+    for (auto x = x_start; x < x_end; ++x) {
+      store<mode, format>(row[x], color);
+    }
+  } else {
+    // a row is contiguous within each tile, so fill it one tile-wide chunk at a time
+    for (auto x = x_start; x < x_end;) {
+      Pixel *chunk = &pixel_at<layout>(fb, x, y);
+      const int run = std::min(x_end, (x | Framebuffer::TILE_MASK) + 1) - x;
+      for (auto i = 0; i < run; ++i) {
+        store<mode, format>(chunk[i], color);
       }
+      x += run;
     }
   }
+}
+
+// clip is false only when the dispatcher has proven the whole shape lies inside the framebuffer
+
+template <BlendMode mode, PixelFormat format, FramebufferLayout layout, bool clip>
+int draw(const Rect &instr, Framebuffer &fb) {
+  int x_start, x_end, y_start, y_end;
+  if constexpr (clip) {
+    // clamp rectangle bounds to framebuffer
+    x_start = std::max(instr.pos[0], std::int16_t{0});
+    x_end = std::min(static_cast<std::int16_t>(instr.pos[0] + instr.size[0]),
+                     static_cast<std::int16_t>(fb.width()));
+    y_start = std::max(instr.pos[1], std::int16_t{0});
+    y_end = std::min(static_cast<std::int16_t>(instr.pos[1] + instr.size[1]),
+                     static_cast<std::int16_t>(fb.height()));
+  } else {
+    x_start = instr.pos[0];
+    x_end = instr.pos[0] + instr.size[0];
+    y_start = instr.pos[1];
+    y_end = instr.pos[1] + instr.size[1];
+  }
+
+  for (auto y = y_start; y < y_end; ++y) {
+    fill_span<mode, format, layout>(fb, y, x_start, x_end, instr.color);
+  }
 
   return 0;
 }
 
-int render(const Circle &instr, Framebuffer &fb) {
+template <BlendMode mode, PixelFormat format, FramebufferLayout layout, bool clip>
+int draw(const Circle &instr, Framebuffer &fb) {
   // TODO: see https://github.com/jonahshader/vampire_survivors_vhdl/blob/main/src_hdl/gpu.vhd
   // need to rewrite gpu to make it more generic. i.e., only common parts are renderer and pos.
   // size isn't used in every renderer so it shouldn't be included in the base instruction.
   // same thing here in C++.
-  // optimization: if source is fully transparent, no need to render
-  if (instr.color.a == 0)
-    return 0; // TODO
+  int x_start, x_end, y_start, y_end;
+  if constexpr (clip) {
+    // clamp bounding box to framebuffer
+    x_start = std::max(static_cast<std::int16_t>(instr.pos[0] - instr.radius), std::int16_t{0});
+    x_end = std::min(static_cast<std::int16_t>(instr.pos[0] + instr.radius + 1),
+                     static_cast<std::int16_t>(fb.width()));
+    y_start = std::max(static_cast<std::int16_t>(instr.pos[1] - instr.radius), std::int16_t{0});
+    y_end = std::min(static_cast<std::int16_t>(instr.pos[1] + instr.radius + 1),
+                     static_cast<std::int16_t>(fb.height()));
+  } else {
+    x_start = instr.pos[0] - instr.radius;
+    x_end = instr.pos[0] + instr.radius + 1;
+    y_start = instr.pos[1] - instr.radius;
+    y_end = instr.pos[1] + instr.radius + 1;
+  }
+  const std::int64_t r2 = instr.radius * instr.radius;
 
-  // clamp rectangle bounds to framebuffer
-  auto x_start = std::max(static_cast<std::int16_t>(instr.pos[0] - instr.radius), std::int16_t{0});
-  auto x_end = std::min(static_cast<std::int16_t>(instr.pos[0] + instr.radius + 1), static_cast<std::int16_t>(fb.width()));
-  auto y_start = std::max(static_cast<std::int16_t>(instr.pos[1] - instr.radius), std::int16_t{0});
-  auto y_end = std::min(static_cast<std::int16_t>(instr.pos[1] + instr.radius + 1), static_cast<std::int16_t>(fb.height()));
-  std::uint32_t r2 = instr.radius * instr.radius;
+  // instead of testing dx * dx + dy * dy <= r2 per pixel, find the widest dx that passes for each
+  // row and fill that span. this covers exactly the same pixels.
+  for (auto y = y_start; y < y_end; ++y) {
+    const std::int64_t dy = y - instr.pos[1];
+    const std::int64_t rem = r2 - dy * dy;
+    if (rem < 0)
+      continue;
+    auto half = static_cast<std::int64_t>(std::sqrt(static_cast<double>(rem)));
+    while (half * half > rem)
+      --half;
+    while ((half + 1) * (half + 1) <= rem)
+      ++half;
 
-  // optimization: if source is fully opaque, we can skip blending
-  if (instr.color.a == std::numeric_limits<std::uint8_t>::max()) {
-    for (auto y = y_start; y < y_end; ++y) {
-      for (auto x = x_start; x < x_end; ++x) {
-        auto dx = x - instr.pos[0];
-        auto dy = y - instr.pos[1];
-        if (dx * dx + dy * dy <= r2) {
-          fb.at(x, y) = instr.color;
-        }
-      }
-    }
-  }
-  // standard alpha blending
-  else {
-    for (auto y = y_start; y < y_end; ++y) {
-      for (auto x = x_start; x < x_end; ++x) {
-        auto dx = x - instr.pos[0];
-        auto dy = y - instr.pos[1];
-        if (dx * dx + dy * dy <= r2) {
-          const Pixel existing = fb.at(x, y);
-          fb.at(x, y) = alpha_blend(instr.color, existing);
-        }
-      }
+    auto span_start = static_cast<int>(instr.pos[0] - half);
+    auto span_end = static_cast<int>(instr.pos[0] + half + 1);
+    if constexpr (clip) {
+      span_start = std::max(span_start, x_start);
+      span_end = std::min(span_end, x_end);
     }
+    fill_span<mode, format, layout>(fb, y, span_start, span_end, instr.color);
   }
 
-  return 0; // TODO
+  return 0;
 }
 
-int render(const Line &instr, Framebuffer &fb) {
-  // optimization: if source is fully transparent, no need to render
-  if (instr.color.a == 0)
-    return 0;
+template <bool steep, BlendMode mode, PixelFormat format, FramebufferLayout layout, bool clip>
+void plot_line(int x0, int x1, int y0, int dx, int dy, int ystep, const Pixel &color,
+               Framebuffer &fb) {
+  const int width = fb.width();
+  const int height = fb.height();
+
+  // bresenham algorithm variables
+  int error = 0;
+  int y = y0;
+
+  // main line drawing loop
+  for (int x = x0; x <= x1; ++x) {
+    // determine actual pixel coordinates (handle steep case)
+    const int pixel_x = steep ? y : x;
+    const int pixel_y = steep ? x : y;
+
+    if (!clip || (pixel_x >= 0 && pixel_x < width && pixel_y >= 0 && pixel_y < height)) {
+      store<mode, format>(pixel_at<layout>(fb, pixel_x, pixel_y), color);
+    }
+
+    // update error and y coordinate
+    error += dy;
+    if ((error << 1) >= dx) { // equivalent to (error * 2) >= dx
+      y += ystep;
+      error -= dx;
+    }
+  }
+}
 
+template <BlendMode mode, PixelFormat format, FramebufferLayout layout, bool clip>
+int draw(const Line &instr, Framebuffer &fb) {
   // extract coordinates
   int x0 = instr.start[0];
   int y0 = instr.start[1];
@@ -150,39 +215,162 @@ int render(const Line &instr, Framebuffer &fb) {
   // determine y step direction
   int ystep = (y0 < y1) ? 1 : -1;
 
-  // bresenham algorithm variables
-  int error = 0;
-  int y = y0;
+  if (steep) {
+    plot_line<true, mode, format, layout, clip>(x0, x1, y0, dx, dy, ystep, instr.color, fb);
+  } else {
+    plot_line<false, mode, format, layout, clip>(x0, x1, y0, dx, dy, ystep, instr.color, fb);
+  }
 
-  // optimization: if source is fully opaque, we can skip blending
-  bool use_blending = (instr.color.a != std::numeric_limits<std::uint8_t>::max());
+  return 0; // success
+}
 
-  // main line drawing loop
-  for (int x = x0; x <= x1; ++x) {
-    // determine actual pixel coordinates (handle steep case)
-    int pixel_x = steep ? y : x;
-    int pixel_y = steep ? x : y;
+template <BlendMode mode, PixelFormat format, FramebufferLayout layout, bool clip,
+          FramebufferLayout src_layout>
+void blit(const Blit &instr, Framebuffer &fb) {
+  const Framebuffer &source = *instr.source;
+  const int src_w = instr.src_size[0];
+  const int src_h = instr.src_size[1];
+  const int dst_w = instr.size[0];
+  const int dst_h = instr.size[1];
 
-    // bounds checking and pixel setting
-    if (pixel_x >= 0 && pixel_x < fb.width() && pixel_y >= 0 && pixel_y < fb.height()) {
+  int x_start, x_end, y_start, y_end;
+  if constexpr (clip) {
+    x_start = std::max<int>(instr.pos[0], 0);
+    x_end = std::min<int>(instr.pos[0] + dst_w, fb.width());
+    y_start = std::max<int>(instr.pos[1], 0);
+    y_end = std::min<int>(instr.pos[1] + dst_h, fb.height());
+  } else {
+    x_start = instr.pos[0];
+    x_end = instr.pos[0] + dst_w;
+    y_start = instr.pos[1];
+    y_end = instr.pos[1] + dst_h;
+  }
+
+  const int first_dx = x_start - instr.pos[0];
+  // nearest-neighbor step: sx advances src_w / dst_w per destination pixel, split into a whole
+  // step and a remainder that carries at most one more, so there is no division per pixel
+  const int step = src_w / dst_w;
+  const int fraction = src_w % dst_w;
+  for (auto y = y_start; y < y_end; ++y) {
+    const int sy = instr.src_pos[1] + (y - instr.pos[1]) * src_h / dst_h;
+    if (clip && (sy < 0 || sy >= source.height()))
+      continue;
 
-      if (use_blending) {
-        const Pixel existing = fb.at(pixel_x, pixel_y);
-        fb.at(pixel_x, pixel_y) = alpha_blend(instr.color, existing);
-      } else {
-        fb.at(pixel_x, pixel_y) = instr.color;
+    int sx = instr.src_pos[0] + first_dx * src_w / dst_w;
+    int remainder = first_dx * src_w % dst_w;
+    for (auto x = x_start; x < x_end; ++x) {
+      if (!clip || (sx >= 0 && sx < source.width())) {
+        store<mode, format>(pixel_at<layout>(fb, x, y), pixel_at<src_layout>(source, sx, sy));
+      }
+      sx += step;
+      remainder += fraction;
+      if (remainder >= dst_w) {
+        remainder -= dst_w;
+        ++sx;
       }
     }
+  }
+}
 
-    // update error and y coordinate
-    error += dy;
-    if ((error << 1) >= dx) { // equivalent to (error * 2) >= dx
-      y += ystep;
-      error -= dx;
-    }
+template <BlendMode mode, PixelFormat format, FramebufferLayout layout, bool clip>
+int draw(const Blit &instr, Framebuffer &fb) {
+  if (instr.source->layout() == FramebufferLayout::LINEAR) {
+    blit<mode, format, layout, clip, FramebufferLayout::LINEAR>(instr, fb);
+  } else {
+    blit<mode, format, layout, clip, FramebufferLayout::TILED>(instr, fb);
   }
+  return 0;
+}
 
-  return 0; // success
+// picks the blend mode, or returns false if there is nothing to draw
+template <typename Shape> bool select_mode(const Shape &instr, BlendMode &mode) {
+  // optimization: if source is fully transparent, no need to render
+  if (instr.color.a == 0)
+    return false;
+  // optimization: if source is fully opaque, we can skip blending
+  mode = instr.color.a == std::numeric_limits<std::uint8_t>::max() ? BlendMode::REPLACE
+                                                                   : BlendMode::ALPHA;
+  return true;
+}
+
+bool select_mode(const Blit &instr, BlendMode &mode) {
+  if (instr.source == nullptr || instr.src_size[0] <= 0 || instr.src_size[1] <= 0 ||
+      instr.size[0] <= 0 || instr.size[1] <= 0)
+    return false;
+  mode = instr.blend ? BlendMode::ALPHA : BlendMode::REPLACE;
+  return true;
+}
+
+// does the shape lie entirely inside the framebuffer?
+bool fits(const Rect &instr, const Framebuffer &fb) {
+  return instr.pos[0] >= 0 && instr.pos[1] >= 0 && instr.pos[0] + instr.size[0] <= fb.width() &&
+         instr.pos[1] + instr.size[1] <= fb.height();
+}
+
+bool fits(const Circle &instr, const Framebuffer &fb) {
+  return instr.pos[0] - instr.radius >= 0 && instr.pos[1] - instr.radius >= 0 &&
+         instr.pos[0] + instr.radius < fb.width() && instr.pos[1] + instr.radius < fb.height();
+}
+
+bool fits(const Line &instr, const Framebuffer &fb) {
+  return std::min(instr.start[0], instr.end[0]) >= 0 &&
+         std::min(instr.start[1], instr.end[1]) >= 0 &&
+         std::max(instr.start[0], instr.end[0]) < fb.width() &&
+         std::max(instr.start[1], instr.end[1]) < fb.height();
+}
+
+bool fits(const Blit &instr, const Framebuffer &fb) {
+  const Framebuffer &source = *instr.source;
+  return instr.pos[0] >= 0 && instr.pos[1] >= 0 && instr.pos[0] + instr.size[0] <= fb.width() &&
+         instr.pos[1] + instr.size[1] <= fb.height() && instr.src_pos[0] >= 0 &&
+         instr.src_pos[1] >= 0 && instr.src_pos[0] + instr.src_size[0] <= source.width() &&
+         instr.src_pos[1] + instr.src_size[1] <= source.height();
+}
+
+// kernel table, indexed by (shape, blend mode, pixel format, layout, clip)
+using Kernel = int (*)(const Instruction &, Framebuffer &);
+
+constexpr std::size_t kernel_index(std::size_t shape, BlendMode mode, PixelFormat format,
+                                   FramebufferLayout layout, bool clip) {
+  std::size_t index = shape;
+  index = index * BLEND_MODE_COUNT + static_cast<std::size_t>(mode);
+  index = index * PIXEL_FORMAT_COUNT + static_cast<std::size_t>(format);
+  index = index * LAYOUT_COUNT + static_cast<std::size_t>(layout);
+  return index * 2 + (clip ? 1 : 0);
+}
+
+template <std::size_t index> int kernel(const Instruction &instr, Framebuffer &fb) {
+  constexpr bool clip = index % 2 != 0;
+  constexpr auto layout = static_cast<FramebufferLayout>(index / 2 % LAYOUT_COUNT);
+  constexpr auto format = static_cast<PixelFormat>(index / 2 / LAYOUT_COUNT % PIXEL_FORMAT_COUNT);
+  constexpr auto mode = static_cast<BlendMode>(index / 2 / LAYOUT_COUNT / PIXEL_FORMAT_COUNT %
+                                               BLEND_MODE_COUNT);
+  constexpr std::size_t shape = index / 2 / LAYOUT_COUNT / PIXEL_FORMAT_COUNT / BLEND_MODE_COUNT;
+  static_assert(kernel_index(shape, mode, format, layout, clip) == index);
+
+  return draw<mode, format, layout, clip>(*std::get_if<shape>(&instr), fb);
+}
+
+template <std::size_t... indices>
+constexpr std::array<Kernel, sizeof...(indices)> make_kernels(std::index_sequence<indices...>) {
+  return {&kernel<indices>...};
+}
+
+// every shape x blend mode x pixel format x layout, unclipped and clipped
+constexpr std::size_t KERNEL_COUNT =
+    SHAPE_COUNT * BLEND_MODE_COUNT * PIXEL_FORMAT_COUNT * LAYOUT_COUNT * 2;
+constexpr auto KERNELS = make_kernels(std::make_index_sequence<KERNEL_COUNT>{});
+
+} // namespace
+
+int render(const Instruction &instr, Framebuffer &fb) {
+  BlendMode mode;
+  if (!std::visit([&mode](const auto &shape) { return select_mode(shape, mode); }, instr))
+    return 0;
+  const bool clip = !std::visit([&fb](const auto &shape) { return fits(shape, fb); }, instr);
+
+  const auto index = kernel_index(instr.index(), mode, PixelFormat::RGBA8888, fb.layout(), clip);
+  return KERNELS[index](instr, fb);
 }
 
 }; // namespace gpu
@@ -44,8 +44,25 @@ struct Line {
   Pixel color;
 };
 
-using Instruction = std::variant<Rect, Circle, Line>;
+// Draws src_size pixels of source starting at src_pos into the size rect at pos, using
+// nearest-neighbor sampling. size = k * src_size gives an integer upscale, size < src_size a
+// downscale. when blend is false source pixels are copied as-is, otherwise each one is alpha
+// blended by its own alpha. source must outlive the instruction and must not be the framebuffer
+// being rendered to. source pixels outside source are skipped.
+struct Blit {
+  const Framebuffer *source;
+  Vector2<int16_t> src_pos;
+  Vector2<int16_t> src_size;
+  Vector2<int16_t> pos;
+  Vector2<int16_t> size;
+  bool blend;
+};
+
+using Instruction = std::variant<Rect, Circle, Line, Blit>;
 
 int render(const Instruction &instr, Framebuffer &fb);
 
+// OpenGL-style alpha blending: GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA
+Pixel alpha_blend(const Pixel &source, const Pixel &dest);
+
 }; // namespace gpu
@@ -0,0 +1,81 @@
+#include "heatmap.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "gpu.h"
+
+namespace gpu {
+
+HeatmapLUT make_heat_lut() {
+  HeatmapLUT lut;
+  lut[0] = Pixel(0, 0, 0, 0);
+  for (int i = 1; i < 256; ++i) {
+    // three segments: red ramps up, then green, then blue
+    const int r = std::min(i * 3, 255);
+    const int g = std::clamp(i * 3 - 255, 0, 255);
+    const int b = std::clamp(i * 3 - 510, 0, 255);
+    lut[i] = Pixel(r, g, b, 255);
+  }
+  return lut;
+}
+
+void Heatmap::clear() {
+  std::fill(grid.begin(), grid.end(), 0);
+}
+
+void Heatmap::scatter(std::span<const Eigen::Vector2<std::int16_t>> positions,
+                      std::span<const std::uint16_t> weights) {
+  const bool weighted = !weights.empty();
+  const int count = static_cast<int>(positions.size());
+  std::uint32_t *cells = grid.data();
+
+  // positions are usually spread out, so contention on a single cell is rare and atomics beat
+  // per-thread grids plus a reduction at these resolutions
+#pragma omp parallel for schedule(static)
+  for (int i = 0; i < count; ++i) {
+    const int x = positions[i][0];
+    const int y = positions[i][1];
+    if (x < 0 || x >= m_width || y < 0 || y >= m_height)
+      continue;
+    const std::uint32_t w = weighted ? weights[i] : 1;
+#pragma omp atomic
+    cells[y * m_width + x] += w;
+  }
+}
+
+std::uint32_t Heatmap::resolve(Framebuffer &fb, const HeatmapLUT &lut,
+                               std::uint32_t max_count) const {
+  if (max_count == 0) {
+    max_count = *std::max_element(grid.begin(), grid.end());
+    if (max_count == 0)
+      return 0; // nothing to draw
+  }
+
+  const int width = std::min(m_width, fb.width());
+  const int height = std::min(m_height, fb.height());
+  Pixel *out = fb.data();
+
+#pragma omp parallel for schedule(static)
+  for (int y = 0; y < height; ++y) {
+    const std::uint32_t *row = grid.data() + y * m_width;
+    for (int x = 0; x < width; ++x) {
+      const std::uint32_t c = row[x];
+      if (c == 0)
+        continue;
+      // any non-empty cell maps to at least entry 1 so sparse cells stay visible
+      const auto scaled = static_cast<std::uint64_t>(std::min(c, max_count)) * 255 / max_count;
+      const Pixel &color = lut[std::max<std::uint64_t>(scaled, 1)];
+      Pixel &dest = out[fb.offset(x, y)];
+      if (color.a == std::numeric_limits<std::uint8_t>::max()) {
+        dest = color;
+      } else if (color.a != 0) {
+        dest = alpha_blend(color, dest);
+      }
+    }
+  }
+
+  return max_count;
+}
+
+}; // namespace gpu
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "framebuffer.h"
+
+namespace gpu {
+
+using HeatmapLUT = std::array<Pixel, 256>;
+
+// black -> red -> yellow -> white ramp. entry 0 is fully transparent so empty cells keep whatever
+// was already in the framebuffer.
+HeatmapLUT make_heat_lut();
+
+// Density renderer for very large populations. Instead of rasterizing one primitive per entity,
+// positions are scattered into an integer accumulation grid (one cell per framebuffer pixel) and
+// the grid is mapped through a color LUT in a single pass. Cost is O(entities + pixels).
+class Heatmap {
+public:
+  Heatmap(int width, int height) : m_width(width), m_height(height), grid(width * height, 0) {}
+
+  void clear();
+
+  // scatter positions (in framebuffer pixel coordinates) into the grid. positions outside the grid
+  // are dropped. if weights is non-empty it must be the same length as positions (e.g. energy).
+  void scatter(std::span<const Eigen::Vector2<std::int16_t>> positions,
+               std::span<const std::uint16_t> weights = {});
+
+  // map the grid into fb through lut. cells are normalized against max_count, or against the
+  // largest cell in the grid if max_count is 0. cells whose lut entry has zero alpha are skipped.
+  // returns the count that was used for normalization.
+  std::uint32_t resolve(Framebuffer &fb, const HeatmapLUT &lut, std::uint32_t max_count = 0) const;
+
+  const std::uint32_t *data() const {
+    return grid.data();
+  }
+
+  int width() const {
+    return m_width;
+  }
+  int height() const {
+    return m_height;
+  }
+
+private:
+  int m_width, m_height;
+  std::vector<std::uint32_t> grid;
+};
+
+}; // namespace gpu
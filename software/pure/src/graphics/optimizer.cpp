@@ -0,0 +1,136 @@
+#include "optimizer.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace gpu {
+
+namespace {
+
+enum class Verdict { KEEP, NOOP, OFFSCREEN };
+
+bool same_color(const Pixel &a, const Pixel &b) {
+  return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+// clips rect to the framebuffer
+Verdict classify(Rect &rect, int width, int height) {
+  if (rect.color.a == 0 || rect.size[0] <= 0 || rect.size[1] <= 0)
+    return Verdict::NOOP;
+
+  const int x_start = std::max<int>(rect.pos[0], 0);
+  const int x_end = std::min<int>(rect.pos[0] + rect.size[0], width);
+  const int y_start = std::max<int>(rect.pos[1], 0);
+  const int y_end = std::min<int>(rect.pos[1] + rect.size[1], height);
+  if (x_start >= x_end || y_start >= y_end)
+    return Verdict::OFFSCREEN;
+
+  rect.pos = {static_cast<std::int16_t>(x_start), static_cast<std::int16_t>(y_start)};
+  rect.size = {static_cast<std::int16_t>(x_end - x_start),
+               static_cast<std::int16_t>(y_end - y_start)};
+  return Verdict::KEEP;
+}
+
+Verdict classify(const Circle &circle, int width, int height) {
+  if (circle.color.a == 0 || circle.radius < 0)
+    return Verdict::NOOP;
+  if (circle.pos[0] + circle.radius < 0 || circle.pos[0] - circle.radius >= width ||
+      circle.pos[1] + circle.radius < 0 || circle.pos[1] - circle.radius >= height)
+    return Verdict::OFFSCREEN;
+  return Verdict::KEEP;
+}
+
+Verdict classify(const Line &line, int width, int height) {
+  if (line.color.a == 0)
+    return Verdict::NOOP;
+  if (std::max(line.start[0], line.end[0]) < 0 || std::min(line.start[0], line.end[0]) >= width ||
+      std::max(line.start[1], line.end[1]) < 0 || std::min(line.start[1], line.end[1]) >= height)
+    return Verdict::OFFSCREEN;
+  return Verdict::KEEP;
+}
+
+// blits are culled but never clipped, clipping would move the sampling grid
+Verdict classify(const Blit &blit, int width, int height) {
+  if (blit.source == nullptr || blit.src_size[0] <= 0 || blit.src_size[1] <= 0 ||
+      blit.size[0] <= 0 || blit.size[1] <= 0)
+    return Verdict::NOOP;
+  if (blit.pos[0] + blit.size[0] <= 0 || blit.pos[0] >= width ||
+      blit.pos[1] + blit.size[1] <= 0 || blit.pos[1] >= height)
+    return Verdict::OFFSCREEN;
+  return Verdict::KEEP;
+}
+
+// merges b (drawn after a) into a if the result renders identically. both rects are already
+// clipped.
+bool try_merge(Rect &a, const Rect &b) {
+  if (!same_color(a.color, b.color))
+    return false;
+
+  // opaque rects can overlap since overwriting a pixel with the same color is a no-op. blended
+  // rects must only touch, otherwise the overlap would lose its second blend.
+  const bool opaque = a.color.a == std::numeric_limits<std::uint8_t>::max();
+
+  for (int axis = 0; axis < 2; ++axis) {
+    const int other = 1 - axis;
+    // the rects must line up exactly on the other axis
+    if (a.pos[other] != b.pos[other] || a.size[other] != b.size[other])
+      continue;
+
+    const int a_start = a.pos[axis], a_end = a.pos[axis] + a.size[axis];
+    const int b_start = b.pos[axis], b_end = b.pos[axis] + b.size[axis];
+    const bool mergeable = opaque ? (b_start <= a_end && b_end >= a_start)
+                                  : (b_start == a_end || b_end == a_start);
+    if (!mergeable)
+      continue;
+
+    const int start = std::min(a_start, b_start);
+    a.pos[axis] = static_cast<std::int16_t>(start);
+    a.size[axis] = static_cast<std::int16_t>(std::max(a_end, b_end) - start);
+    return true;
+  }
+  return false;
+}
+
+} // namespace
+
+OptimizeStats optimize(std::vector<Instruction> &instrs, int width, int height) {
+  OptimizeStats stats;
+  stats.input = static_cast<int>(instrs.size());
+
+  // compact in place: out is the write cursor, everything before it is already optimized
+  std::size_t out = 0;
+  for (std::size_t i = 0; i < instrs.size(); ++i) {
+    Instruction instr = instrs[i];
+    const Verdict verdict =
+        std::visit([&](auto &shape) { return classify(shape, width, height); }, instr);
+    if (verdict == Verdict::NOOP) {
+      ++stats.dropped_noop;
+      continue;
+    }
+    if (verdict == Verdict::OFFSCREEN) {
+      ++stats.dropped_offscreen;
+      continue;
+    }
+
+    if (out > 0 && std::holds_alternative<Rect>(instr) &&
+        std::holds_alternative<Rect>(instrs[out - 1]) &&
+        try_merge(std::get<Rect>(instrs[out - 1]), std::get<Rect>(instr))) {
+      ++stats.merged;
+      // a grown rect may now complete a strip with the one before it (e.g. rows of tiles)
+      while (out > 1 && std::holds_alternative<Rect>(instrs[out - 2]) &&
+             try_merge(std::get<Rect>(instrs[out - 2]), std::get<Rect>(instrs[out - 1]))) {
+        ++stats.merged;
+        --out;
+      }
+      continue;
+    }
+
+    instrs[out++] = instr;
+  }
+
+  instrs.resize(out);
+  stats.output = static_cast<int>(out);
+  return stats;
+}
+
+}; // namespace gpu
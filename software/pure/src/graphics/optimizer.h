@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+
+#include "gpu.h"
+
+namespace gpu {
+
+struct OptimizeStats {
+  int input = 0;             // instructions before optimization
+  int output = 0;            // instructions after optimization
+  int dropped_noop = 0;      // zero alpha or empty shapes
+  int dropped_offscreen = 0; // entirely outside the framebuffer
+  int merged = 0;            // rects folded into a neighbouring rect
+
+  int eliminated() const {
+    return input - output;
+  }
+};
+
+// Rewrites an instruction list in place so that rendering it produces the same framebuffer with
+// fewer instructions (and, on the hardware GPU, fewer go/done handshakes):
+// - instructions that render returns from early (zero alpha, empty rects, negative radius) are
+//   removed
+// - instructions entirely outside a width x height framebuffer are removed
+// - rects are clipped to the framebuffer once, so render never needs to clamp them
+// - consecutive same-color rects whose union is a rectangle are merged. opaque rects may overlap,
+//   blended rects must only touch so no pixel is blended twice.
+// circles, lines and blits are never clipped since that would change which pixels they cover.
+OptimizeStats optimize(std::vector<Instruction> &instrs, int width, int height);
+
+}; // namespace gpu
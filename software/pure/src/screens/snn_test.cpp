@@ -1,19 +1,15 @@
 #include "snn_test.h"
 #include "audio/audio_manager.h"
 #include <cmath>
-#include <numbers>
 
 SNNTestScreen::SNNTestScreen(ScreenContext &ctx) : Screen(ctx), rng(std::random_device{}()) {
   // Initialize Fourier feature parameters
-  std::uniform_real_distribution<float> phase_dist(0.0f, 2.0f * std::numbers::pi_v<float>);
-  std::uniform_real_distribution<float> freq_dist(1.0f, 8.0f);
-
-  for (int i = 0; i < INPUTS; ++i) {
-    fourier_phases[i] = phase_dist(rng);
-    fourier_freqs[i] = freq_dist(rng);
-  }
+  fourier.init(rng);
+  encoder.init(fourier);
 
   network.init(rng);
+  audio_consumer = spikes.subscribe();
+  raster_consumer = spikes.subscribe();
 
   // Initialize audio source
   cached_audio_source = std::make_shared<CachedAudioSource>();
@@ -41,8 +37,6 @@ void SNNTestScreen::hide() {
 }
 
 void SNNTestScreen::update() {
-  const auto &mouse = get_mouse_state();
-
   // Handle keyboard to adjust input multiplier
   if (is_key_just_pressed(SDL_SCANCODE_EQUALS) || is_key_just_pressed(SDL_SCANCODE_KP_PLUS)) {
     input_multiplier *= 1.1f;
@@ -54,42 +48,30 @@ void SNNTestScreen::update() {
   }
 
   // Generate input from mouse position using Fourier features
-  std::array<int8_t, INPUTS> input;
-  generate_fourier_input(mouse.x, mouse.y, input);
+  ++tick;
+  const auto input = sensory_input();
 
   // Update the neural network
   network.update(input);
-
-  // Trigger audio for all neurons with panning
-  if (cached_audio_source) {
-    for (int i = 0; i < HIDDEN; ++i) {
-      if (network.act_hidden[i]) {
-        // Map neuron index to pan: -1.0 (left) to 1.0 (right)
-        float pan = (static_cast<float>(i) / (HIDDEN - 1)) * 2.0f - 1.0f;
-        cached_audio_source->trigger_click(0.2f, 0.0f, pan);
-      }
+  spikes.publish(0, tick, network.act_hidden);
+
+  // Trigger audio for every spike with panning. the stream is drained even without a source, so
+  // it never holds back the other consumers
+  spikes.poll(audio_consumer, [this](const SpikeEvent &event) {
+    if (cached_audio_source) {
+      // Map neuron index to pan: -1.0 (left) to 1.0 (right)
+      float pan = (static_cast<float>(event.neuron) / (HIDDEN - 1)) * 2.0f - 1.0f;
+      cached_audio_source->trigger_click(0.2f, 0.0f, pan);
     }
-  }
+  });
 }
 
-void SNNTestScreen::generate_fourier_input(float mouse_x, float mouse_y,
-                                           std::array<int8_t, INPUTS> &input) {
-  for (int i = 0; i < INPUTS; ++i) {
-    // Generate Fourier features: sin/cos of different frequencies applied to mouse position
-    float feature;
-    if (i % 2 == 0) {
-      // Even indices: sin features
-      feature = std::sin(fourier_freqs[i] * mouse_x + fourier_phases[i]);
-    } else {
-      // Odd indices: cos features
-      feature = std::cos(fourier_freqs[i] * mouse_y + fourier_phases[i]);
-    }
-
-    // Apply some transforms
-    feature *= input_multiplier;
-    feature = std::clamp(feature, -1.0f, 1.0f);
-    input[i] = static_cast<int8_t>(feature * 127.0f);
-  }
+std::span<const int8_t> SNNTestScreen::sensory_input() {
+  return sensory.get(tick, INPUTS, [this](std::span<int8_t> out) {
+    const auto &mouse = get_mouse_state();
+    encoder.set_multiplier(input_multiplier);
+    encoder.encode(std::span<const float>(&mouse.x, 1), std::span<const float>(&mouse.y, 1), out);
+  });
 }
 
 void SNNTestScreen::render(Framebuffer &fb) {
@@ -101,9 +83,7 @@ void SNNTestScreen::render(Framebuffer &fb) {
   // }
 
   // Simple 1x1 pixel visualization, left-aligned
-  const auto &mouse = get_mouse_state();
-  std::array<int8_t, INPUTS> current_input;
-  generate_fourier_input(mouse.x, mouse.y, current_input);
+  const auto current_input = sensory_input();
 
   // Input (orange)
   int j = 0;
@@ -126,9 +106,21 @@ void SNNTestScreen::render(Framebuffer &fb) {
     ++j;
   }
 
-  // Hidden activation (red)
+  // Hidden activation (red), the spikes of the latest tick in the stream
+  spikes.poll(raster_consumer, [this](const SpikeEvent &event) {
+    if (event.tick != raster_tick) {
+      raster.fill(false);
+      raster_tick = event.tick;
+    }
+    raster[event.neuron] = true;
+  });
+  if (raster_tick != static_cast<uint32_t>(tick)) {
+    // the latest tick had no spikes
+    raster.fill(false);
+    raster_tick = static_cast<uint32_t>(tick);
+  }
   for (int i = 0; i < HIDDEN && i < fb.width(); ++i) {
-    bool is_active = network.act_hidden[i];
+    bool is_active = raster[i];
     uint8_t intensity = is_active ? 255 : 80;
     fb.at(j, row) = Pixel(intensity, 0, 0, 255);
     ++j;
@@ -1,6 +1,9 @@
 #pragma once
 
+#include "systems/fourier_features.h"
+#include "systems/sensory_encoder.h"
 #include "systems/snn.h"
+#include "systems/spike_stream.h"
 #include "audio/cached_audio_source.h"
 #include "screen.h"
 #include <array>
@@ -27,12 +30,23 @@ private:
   std::mt19937 rng;
 
   // Fourier feature parameters for mouse input
-  std::array<float, INPUTS> fourier_phases;
-  std::array<float, INPUTS> fourier_freqs;
+  FourierFeatures<INPUTS> fourier;
+  FourierEncoder<INPUTS> encoder;
   float input_multiplier = 1.0f;
 
+  // inputs are encoded once per update and reused by render
+  SensoryFrame sensory;
+  uint64_t tick = 0;
+
+  // spikes are published once per update; audio and the raster each read them from the stream
+  SpikeStream<4096> spikes;
+  int audio_consumer = -1;
+  int raster_consumer = -1;
+  std::array<bool, HIDDEN> raster{};
+  uint32_t raster_tick = 0;
+
   // Audio for spike sounds
   std::shared_ptr<CachedAudioSource> cached_audio_source;
 
-  void generate_fourier_input(float mouse_x, float mouse_y, std::array<int8_t, INPUTS> &input);
+  std::span<const int8_t> sensory_input();
 };
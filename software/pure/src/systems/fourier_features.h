@@ -0,0 +1,41 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <random>
+#include <span>
+
+// Encodes a 2d position as `features` int8 SNN inputs: even features are sin(freq * x + phase), odd
+// features cos(freq * y + phase), scaled by a multiplier and clamped to [-1, 1].
+template <int features> struct FourierFeatures {
+  std::array<float, features> phases;
+  std::array<float, features> freqs;
+
+  void init(std::mt19937 &rng) {
+    std::uniform_real_distribution<float> phase_dist(0.0f, 2.0f * std::numbers::pi_v<float>);
+    std::uniform_real_distribution<float> freq_dist(1.0f, 8.0f);
+    for (int i = 0; i < features; ++i) {
+      phases[i] = phase_dist(rng);
+      freqs[i] = freq_dist(rng);
+    }
+  }
+
+  void encode(float x, float y, float multiplier, std::span<int8_t> input) const {
+    for (int i = 0; i < features; ++i) {
+      // sin/cos of different frequencies applied to the position
+      float feature;
+      if (i % 2 == 0) {
+        feature = std::sin(freqs[i] * x + phases[i]);
+      } else {
+        feature = std::cos(freqs[i] * y + phases[i]);
+      }
+
+      feature *= multiplier;
+      feature = std::clamp(feature, -1.0f, 1.0f);
+      input[i] = static_cast<int8_t>(feature * 127.0f);
+    }
+  }
+};
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "snn.h"
+
+// Weights of a frozen SNN<inputs, hidden, outputs>, in SNN's layout. the members are in
+// SNNGenomePool record order, which is what snn_freeze emits. declare one constexpr (usually in a
+// generated header) and step it with FrozenSNN.
+template <int inputs, int hidden, int outputs> struct FrozenWeights {
+  static constexpr int INPUTS = inputs;
+  static constexpr int HIDDEN = hidden;
+  static constexpr int OUTPUTS = outputs;
+
+  array<int8_t, hidden * inputs> w_hidden_input;
+  array<int8_t, hidden * hidden> w_hidden_hidden;
+  array<int8_t, hidden * outputs> w_output_hidden;
+  array<uint8_t, hidden> b_hidden;
+};
+
+// copy frozen weights into a regular network, with cleared state
+template <int inputs, int hidden, int outputs>
+void thaw(const FrozenWeights<inputs, hidden, outputs> &weights,
+          SNN<inputs, hidden, outputs> &net) {
+  net.w_hidden_input = weights.w_hidden_input;
+  net.w_hidden_hidden = weights.w_hidden_hidden;
+  net.w_output_hidden = weights.w_output_hidden;
+  net.b_hidden = weights.b_hidden;
+  net.clear();
+}
+
+namespace frozen_snn {
+
+// one nonzero weight, w[row * columns + column]
+struct Synapse {
+  uint16_t row;
+  uint16_t column;
+  int8_t w;
+};
+
+using Column = void (*)(int16_t *);
+
+// f(integral_constant<k>) for k in [0, n), in order. a braced list rather than a fold expression,
+// so long runs don't hit compiler nesting limits
+template <std::size_t n, typename F> void unroll(F &&f) {
+  [&]<std::size_t... k>(std::index_sequence<k...>) {
+    (void)std::initializer_list<int>{(f(std::integral_constant<std::size_t, k>{}), 0)...};
+  }(std::make_index_sequence<n>{});
+}
+
+template <std::size_t size> constexpr std::size_t count_nonzero(const array<int8_t, size> &w) {
+  std::size_t count = 0;
+  for (auto v : w)
+    count += v != 0;
+  return count;
+}
+
+// nonzero entries of a rows x columns matrix, in row order
+template <std::size_t count, int columns, std::size_t size>
+constexpr array<Synapse, count> nonzero(const array<int8_t, size> &w) {
+  array<Synapse, count> out{};
+  std::size_t n = 0;
+  for (std::size_t k = 0; k < size; ++k) {
+    if (w[k] != 0)
+      out[n++] = {static_cast<uint16_t>(k / columns), static_cast<uint16_t>(k % columns), w[k]};
+  }
+  return out;
+}
+
+// where each row starts in nonzero()'s output, plus the end
+template <int rows, int columns, std::size_t size>
+constexpr array<std::size_t, rows + 1> row_starts(const array<int8_t, size> &w) {
+  array<std::size_t, rows + 1> starts{};
+  for (int r = 0; r < rows; ++r) {
+    starts[r + 1] = starts[r];
+    for (int c = 0; c < columns; ++c)
+      starts[r + 1] += w[r * columns + c] != 0;
+  }
+  return starts;
+}
+
+// rows and matrices with at least this fraction of nonzero weights go through the SIMD kernels,
+// which beat one scalar add per immediate once there are few zeros to skip
+constexpr int DENSE_PERCENT = 50;
+
+constexpr bool dense(std::size_t nonzero, std::size_t size) {
+  return nonzero * 100 >= size * DENSE_PERCENT;
+}
+
+// adds row j of the pre-major matrix w, the weights of presynaptic neuron j
+template <const auto &w, const auto &synapses, const auto &starts, int columns, int j>
+void add_row(int16_t *acc) {
+  constexpr std::size_t begin = starts[j], end = starts[j + 1];
+  if constexpr (dense(end - begin, columns)) {
+    const int8_t *row = &w[j * columns];
+#pragma omp simd
+    for (int i = 0; i < columns; ++i)
+      acc[i] = static_cast<int16_t>(acc[i] + row[i]);
+  } else {
+    unroll<end - begin>([&](auto k) {
+      constexpr Synapse s = synapses[begin + k];
+      acc[s.column] = static_cast<int16_t>(acc[s.column] + s.w);
+    });
+  }
+}
+
+template <const auto &w, const auto &synapses, const auto &starts, int rows, int columns>
+constexpr array<Column, rows> row_table() {
+  return []<std::size_t... j>(std::index_sequence<j...>) {
+    return array<Column, rows>{&add_row<w, synapses, starts, columns, static_cast<int>(j)>...};
+  }(std::make_index_sequence<rows>{});
+}
+
+} // namespace frozen_snn
+
+// SNN step specialized on a constexpr weight table. zero weights are pruned at compile time and the
+// rest are unrolled with the weight as an immediate, so sparse weights are never loaded from
+// memory:
+// - the input projection is one straight run over the nonzero input synapses
+// - every presynaptic neuron gets its own column function, and a spike calls it through a table
+// matrices and columns that are mostly nonzero (see frozen_snn::DENSE_PERCENT) keep the SIMD
+// kernels on the constexpr table instead. steps exactly like SNN::update on the same weights.
+// code size grows with the nonzero synapse count, so this is meant for showcase-sized champions,
+// not populations.
+template <const auto &weights> class FrozenSNN {
+  using Weights = std::remove_cvref_t<decltype(weights)>;
+
+public:
+  static constexpr int INPUTS = Weights::INPUTS;
+  static constexpr int HIDDEN = Weights::HIDDEN;
+  static constexpr int OUTPUTS = Weights::OUTPUTS;
+
+  array<uint8_t, HIDDEN> s_hidden{};
+  array<uint64_t, spike_words(HIDDEN)> act_hidden{};
+
+  bool spiked(int i) const {
+    return (act_hidden[i / 64] >> (i % 64)) & 1;
+  }
+
+  void clear() {
+    s_hidden.fill(0);
+    act_hidden.fill(0);
+  }
+
+  void update(std::span<int8_t const> input) {
+    array<int16_t, HIDDEN> acc;
+    snn_kernels::integrate_state(HIDDEN, s_hidden.data(), weights.b_hidden.data(), acc.data());
+    const int8_t *in = input.data();
+    if constexpr (frozen_snn::dense(INPUT.size(), HIDDEN * INPUTS)) {
+      snn_simd::project_inputs<INPUTS, HIDDEN>(weights.w_hidden_input.data(), in, acc.data());
+    } else {
+      frozen_snn::unroll<INPUT.size()>([&](auto k) {
+        constexpr frozen_snn::Synapse s = INPUT[k];
+        // rows of w_hidden_input are hidden neurons, columns inputs
+        acc[s.row] += (static_cast<int16_t>(s.w) * static_cast<int16_t>(in[s.column]) >> 8);
+      });
+    }
+
+    array<uint16_t, HIDDEN> spikes;
+    const int spike_count = snn_kernels::collect_spikes(HIDDEN, act_hidden.data(), spikes.data());
+    for (int s = 0; s < spike_count; ++s)
+      RECURRENT_COLUMNS[spikes[s]](acc.data());
+
+    snn_kernels::fire(HIDDEN, acc.data(), s_hidden.data(), act_hidden.data());
+  }
+
+  void get_output(std::vector<int16_t> &output) const {
+    output.assign(OUTPUTS, 0);
+    array<uint16_t, HIDDEN> spikes;
+    const int spike_count = snn_kernels::collect_spikes(HIDDEN, act_hidden.data(), spikes.data());
+    for (int s = 0; s < spike_count; ++s)
+      OUTPUT_COLUMNS[spikes[s]](output.data());
+  }
+
+  // nonzero weights left after pruning
+  static constexpr int synapses() {
+    return static_cast<int>(INPUT.size() + RECURRENT.size() + OUTPUT.size());
+  }
+
+private:
+  static constexpr auto INPUT =
+      frozen_snn::nonzero<frozen_snn::count_nonzero(weights.w_hidden_input), INPUTS>(
+          weights.w_hidden_input);
+  static constexpr auto RECURRENT =
+      frozen_snn::nonzero<frozen_snn::count_nonzero(weights.w_hidden_hidden), HIDDEN>(
+          weights.w_hidden_hidden);
+  static constexpr auto RECURRENT_STARTS =
+      frozen_snn::row_starts<HIDDEN, HIDDEN>(weights.w_hidden_hidden);
+  static constexpr auto OUTPUT =
+      frozen_snn::nonzero<frozen_snn::count_nonzero(weights.w_output_hidden), OUTPUTS>(
+          weights.w_output_hidden);
+  static constexpr auto OUTPUT_STARTS =
+      frozen_snn::row_starts<HIDDEN, OUTPUTS>(weights.w_output_hidden);
+
+  static constexpr auto RECURRENT_COLUMNS =
+      frozen_snn::row_table<weights.w_hidden_hidden, RECURRENT, RECURRENT_STARTS, HIDDEN, HIDDEN>();
+  static constexpr auto OUTPUT_COLUMNS =
+      frozen_snn::row_table<weights.w_output_hidden, OUTPUT, OUTPUT_STARTS, HIDDEN, OUTPUTS>();
+};
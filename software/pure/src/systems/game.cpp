@@ -69,7 +69,7 @@ void Game::run() {
     }
 
     // update texture with framebuffer data and render to screen
-    SDL_UpdateTexture(frame, nullptr, fb.data(), fb.width() * sizeof(Pixel));
+    SDL_UpdateTexture(frame, nullptr, fb.linear_data(), fb.width() * sizeof(Pixel));
     SDL_RenderClear(renderer);
 
     // scale framebuffer to fit window while maintaining aspect ratio
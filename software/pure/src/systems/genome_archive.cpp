@@ -0,0 +1,250 @@
+#include "genome_archive.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <queue>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr char MAGIC[8] = {'S', 'N', 'N', 'G', 'E', 'N', 'O', 'M'};
+constexpr uint32_t VERSION = 1;
+
+} // namespace
+
+MappedFile::~MappedFile() {
+  unmap();
+}
+
+bool MappedFile::map(const std::string &path) {
+  unmap();
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    return false;
+  }
+  m_file = file;
+  m_size = static_cast<std::size_t>(size.QuadPart);
+  // empty files can't be mapped, and don't need to be
+  if (m_size == 0)
+    return true;
+  m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (m_mapping == nullptr) {
+    unmap();
+    return false;
+  }
+  m_data = static_cast<const uint8_t *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+  if (m_data == nullptr) {
+    unmap();
+    return false;
+  }
+#else
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    ::close(fd);
+    return false;
+  }
+  m_size = static_cast<std::size_t>(st.st_size);
+  if (m_size > 0) {
+    void *data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+      ::close(fd);
+      m_size = 0;
+      return false;
+    }
+    m_data = static_cast<const uint8_t *>(data);
+  }
+  // the mapping stays valid after the descriptor is closed
+  ::close(fd);
+#endif
+  return true;
+}
+
+void MappedFile::unmap() {
+#ifdef _WIN32
+  if (m_data != nullptr)
+    UnmapViewOfFile(m_data);
+  if (m_mapping != nullptr)
+    CloseHandle(m_mapping);
+  if (m_file != nullptr)
+    CloseHandle(m_file);
+  m_mapping = nullptr;
+  m_file = nullptr;
+#else
+  if (m_data != nullptr)
+    munmap(const_cast<uint8_t *>(m_data), m_size);
+#endif
+  m_data = nullptr;
+  m_size = 0;
+}
+
+GenomeArchive::~GenomeArchive() {
+  close();
+}
+
+bool GenomeArchive::open(const std::string &path, uint32_t record_size) {
+  close();
+  namespace fs = std::filesystem;
+  const std::string index_path = path + ".index";
+  std::error_code error;
+
+  if (!fs::exists(path, error) || fs::file_size(path, error) == 0) {
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr)
+      return false;
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.record_size = record_size;
+    const bool written = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    std::fclose(file);
+    if (!written)
+      return false;
+    // a stale index would describe records that no longer exist
+    fs::remove(index_path, error);
+  } else {
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr)
+      return false;
+    Header header;
+    const bool read = std::fread(&header, sizeof(header), 1, file) == 1;
+    std::fclose(file);
+    if (!read || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header.version != VERSION || header.record_size != record_size)
+      return false;
+  }
+
+  // a run that died mid-append can leave one file a partial record ahead; cut both back to the
+  // records that are complete in both
+  const uint64_t record_count = (fs::file_size(path, error) - sizeof(Header)) / record_size;
+  const uint64_t index_count =
+      fs::exists(index_path, error) ? fs::file_size(index_path, error) / sizeof(Entry) : 0;
+  const uint64_t count = std::min(record_count, index_count);
+  fs::resize_file(path, sizeof(Header) + count * record_size, error);
+  if (fs::exists(index_path, error))
+    fs::resize_file(index_path, count * sizeof(Entry), error);
+
+  records = std::fopen(path.c_str(), "ab");
+  index = std::fopen(index_path.c_str(), "ab");
+  if (records == nullptr || index == nullptr) {
+    close();
+    return false;
+  }
+  m_path = path;
+  m_record_size = record_size;
+  m_written = count;
+  return remap();
+}
+
+void GenomeArchive::close() {
+  if (records != nullptr)
+    std::fclose(records);
+  if (index != nullptr)
+    std::fclose(index);
+  records = nullptr;
+  index = nullptr;
+  mapped_records.unmap();
+  mapped_index.unmap();
+  m_size = 0;
+  m_written = 0;
+}
+
+uint64_t GenomeArchive::append(std::span<const uint8_t> record, float fitness,
+                               uint32_t generation, uint64_t parent) {
+  const Entry entry{fitness, generation, parent};
+  std::fwrite(record.data(), 1, std::min<std::size_t>(record.size(), m_record_size), records);
+  // short records are zero padded so every record stays record_size bytes
+  for (auto k = record.size(); k < m_record_size; ++k)
+    std::fputc(0, records);
+  std::fwrite(&entry, sizeof(entry), 1, index);
+  return m_written++;
+}
+
+bool GenomeArchive::flush() {
+  if (std::fflush(records) != 0 || std::fflush(index) != 0)
+    return false;
+  return remap();
+}
+
+bool GenomeArchive::remap() {
+  if (!mapped_records.map(m_path) || !mapped_index.map(m_path + ".index"))
+    return false;
+  m_size = std::min<uint64_t>(mapped_index.size() / sizeof(Entry),
+                              (mapped_records.size() - sizeof(Header)) / m_record_size);
+  return true;
+}
+
+const GenomeArchive::Entry &GenomeArchive::entry(uint64_t i) const {
+  return reinterpret_cast<const Entry *>(mapped_index.data())[i];
+}
+
+std::span<const uint8_t> GenomeArchive::record(uint64_t i) const {
+  return {mapped_records.data() + sizeof(Header) + i * m_record_size, m_record_size};
+}
+
+void GenomeArchive::top_k(std::size_t k, std::vector<uint64_t> &out) const {
+  // min-heap of the k best seen so far, so the scan needs O(k) memory
+  using Item = std::pair<float, uint64_t>;
+  std::priority_queue<Item, std::vector<Item>, std::greater<Item>> best;
+  for (uint64_t i = 0; i < m_size; ++i) {
+    const float fitness = entry(i).fitness;
+    if (best.size() < k) {
+      best.emplace(fitness, i);
+    } else if (k > 0 && fitness > best.top().first) {
+      best.pop();
+      best.emplace(fitness, i);
+    }
+  }
+  out.resize(best.size());
+  for (auto slot = out.size(); slot-- > 0;) {
+    out[slot] = best.top().second;
+    best.pop();
+  }
+}
+
+void GenomeArchive::sample(std::size_t n, std::mt19937 &rng, std::vector<uint64_t> &out,
+                           uint32_t min_generation, uint32_t max_generation) const {
+  out.clear();
+  if (m_size == 0)
+    return;
+  std::uniform_int_distribution<uint64_t> dist(0, m_size - 1);
+  if (min_generation == 0 && max_generation == UINT32_MAX) {
+    for (std::size_t s = 0; s < n; ++s)
+      out.push_back(dist(rng));
+    return;
+  }
+
+  // records are appended in generation order in a typical run, but that isn't required, so
+  // collect the qualifying range by scanning the index
+  std::vector<uint64_t> candidates;
+  for (uint64_t i = 0; i < m_size; ++i) {
+    const uint32_t generation = entry(i).generation;
+    if (generation >= min_generation && generation <= max_generation)
+      candidates.push_back(i);
+  }
+  if (candidates.empty())
+    return;
+  std::uniform_int_distribution<std::size_t> pick(0, candidates.size() - 1);
+  for (std::size_t s = 0; s < n; ++s)
+    out.push_back(candidates[pick(rng)]);
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+  MappedFile() = default;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  ~MappedFile();
+
+  bool map(const std::string &path);
+  void unmap();
+
+  const uint8_t *data() const {
+    return m_data;
+  }
+  std::size_t size() const {
+    return m_size;
+  }
+
+private:
+  const uint8_t *m_data = nullptr;
+  std::size_t m_size = 0;
+#ifdef _WIN32
+  void *m_file = nullptr;
+  void *m_mapping = nullptr;
+#endif
+};
+
+// Append-only archive of fixed-size genome records (e.g. SNNGenomePool records), for keeping
+// every notable genome of a long run. two files:
+// - path holds a small header, then the records back to back
+// - path + ".index" holds one GenomeArchive::Entry per record (fitness, generation, parent)
+// both are memory-mapped for reading, so record() is zero-copy and top_k()/sample() only touch the
+// index and the records they return. appends go through buffered writes and become readable
+// after flush().
+class GenomeArchive {
+public:
+  struct Entry {
+    float fitness;
+    uint32_t generation;
+    uint64_t parent; // archive index of a parent, or NO_PARENT
+  };
+  static constexpr uint64_t NO_PARENT = ~uint64_t{0};
+
+  GenomeArchive() = default;
+  GenomeArchive(const GenomeArchive &) = delete;
+  GenomeArchive &operator=(const GenomeArchive &) = delete;
+  ~GenomeArchive();
+
+  // opens an archive, creating it if it doesn't exist. fails if it exists with another record size
+  bool open(const std::string &path, uint32_t record_size);
+  void close();
+
+  // returns the new record's index
+  uint64_t append(std::span<const uint8_t> record, float fitness, uint32_t generation,
+                  uint64_t parent = NO_PARENT);
+  // writes pending appends and remaps, so they can be read
+  bool flush();
+
+  // readable records; appends since the last flush() are not counted
+  uint64_t size() const {
+    return m_size;
+  }
+  uint32_t record_size() const {
+    return m_record_size;
+  }
+  const Entry &entry(uint64_t i) const;
+  std::span<const uint8_t> record(uint64_t i) const;
+
+  // indices of the k fittest records, fittest first
+  void top_k(std::size_t k, std::vector<uint64_t> &out) const;
+  // n indices drawn uniformly with replacement, optionally only from generations
+  // [min_generation, max_generation]. out is empty if no record qualifies
+  void sample(std::size_t n, std::mt19937 &rng, std::vector<uint64_t> &out,
+              uint32_t min_generation = 0, uint32_t max_generation = UINT32_MAX) const;
+
+private:
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint8_t reserved[48];
+  };
+  static_assert(sizeof(Header) == 64);
+  static_assert(sizeof(Entry) == 16);
+
+  std::string m_path;
+  uint32_t m_record_size = 0;
+  uint64_t m_size = 0;    // readable through the mappings
+  uint64_t m_written = 0; // including pending appends
+  std::FILE *records = nullptr;
+  std::FILE *index = nullptr;
+  MappedFile mapped_records;
+  MappedFile mapped_index;
+
+  bool remap();
+};
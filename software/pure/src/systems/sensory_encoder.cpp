@@ -0,0 +1,31 @@
+#include "sensory_encoder.h"
+
+namespace sensory {
+
+const std::array<int16_t, SINE_LUT_SIZE> &sine_lut() {
+  static const auto lut = [] {
+    std::array<int16_t, SINE_LUT_SIZE> t;
+    for (int k = 0; k < SINE_LUT_SIZE; ++k) {
+      t[k] = static_cast<int16_t>(
+          std::lround(32767.0 * std::sin(2.0 * std::numbers::pi * k / SINE_LUT_SIZE)));
+    }
+    return t;
+  }();
+  return lut;
+}
+
+const std::array<int8_t, GAUSSIAN_LUT_SIZE> &gaussian_lut() {
+  static const auto lut = [] {
+    std::array<int8_t, GAUSSIAN_LUT_SIZE> t;
+    for (int k = 0; k < GAUSSIAN_LUT_SIZE; ++k) {
+      const double d = static_cast<double>(k) / GAUSSIAN_LUT_SCALE;
+      t[k] = static_cast<int8_t>(std::lround(127.0 * std::exp(-d * d / 2.0)));
+    }
+    // clamped distances land here
+    t[GAUSSIAN_LUT_SIZE - 1] = 0;
+    return t;
+  }();
+  return lut;
+}
+
+} // namespace sensory
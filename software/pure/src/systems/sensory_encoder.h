@@ -0,0 +1,149 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <span>
+#include <vector>
+
+#include "fourier_features.h"
+
+// Batched fixed-point encoders that turn sensor readings (positions, angles, distances) into int8
+// SNN inputs for many creatures at once. floats are converted to fixed point once per reading;
+// everything per feature is integer math and table lookups with no branches, so the inner loops
+// vectorize across features.
+namespace sensory {
+
+// sin over one turn: SINE_LUT_SIZE entries of round(32767 * sin(2 pi k / SINE_LUT_SIZE))
+constexpr int SINE_LUT_BITS = 10;
+constexpr int SINE_LUT_SIZE = 1 << SINE_LUT_BITS;
+const std::array<int16_t, SINE_LUT_SIZE> &sine_lut();
+
+// exp(-d^2 / 2) for d = k / GAUSSIAN_LUT_SCALE, scaled to 127. d beyond the table reads 0
+constexpr int GAUSSIAN_LUT_SIZE = 256;
+constexpr int GAUSSIAN_LUT_SCALE = 64;
+const std::array<int8_t, GAUSSIAN_LUT_SIZE> &gaussian_lut();
+
+} // namespace sensory
+
+// Fixed-point FourierFeatures: feature i of a reading (x, y) is sin(freq * x + phase) for even i
+// and cos(freq * y + phase) for odd i, times a multiplier, clamped to [-1, 1] and scaled to 127.
+// matches FourierFeatures::encode to within an LSB at multiplier 1. the multiplier also scales the
+// sine table's error, so that grows with |multiplier|: it stays within 1 + |multiplier| / 32 LSBs.
+template <int features> class FourierEncoder {
+public:
+  void init(const FourierFeatures<features> &f) {
+    for (int i = 0; i < features; ++i) {
+      // frequencies become Q16 turns per unit, phases Q32 turns
+      const double turns = 1.0 / (2.0 * std::numbers::pi);
+      freq[i] = static_cast<int32_t>(std::lround(f.freqs[i] * turns * 65536.0));
+      double phase_turns = f.phases[i] * turns;
+      phase_turns -= std::floor(phase_turns);
+      phase[i] = static_cast<uint32_t>(phase_turns * 4294967296.0);
+      // cos is sin a quarter turn ahead
+      if (i % 2 != 0)
+        phase[i] += 1u << 30;
+    }
+  }
+
+  // the product with a sine is taken in 64 bits, so large multipliers saturate the features like
+  // the float path instead of overflowing
+  void set_multiplier(float multiplier) {
+    constexpr float MAX_MULTIPLIER = 8388607.0f; // 2^23 - 1, so the Q8 value fits an int32
+    multiplier = std::clamp(multiplier, -MAX_MULTIPLIER, MAX_MULTIPLIER);
+    this->multiplier = static_cast<int32_t>(std::lround(multiplier * 256.0f));
+  }
+
+  // x and y hold one reading per creature. out[n * features + i] gets feature i of creature n
+  void encode(std::span<const float> x, std::span<const float> y, std::span<int8_t> out) const {
+    const int16_t *lut = sensory::sine_lut().data();
+    const int count = static_cast<int>(x.size());
+#pragma omp parallel for schedule(static) if (count > 256)
+    for (int n = 0; n < count; ++n) {
+      // Q16 readings
+      const auto xq = static_cast<int64_t>(x[n] * 65536.0f);
+      const auto yq = static_cast<int64_t>(y[n] * 65536.0f);
+      int8_t *o = &out[static_cast<std::size_t>(n) * features];
+#pragma omp simd
+      for (int i = 0; i < features; ++i) {
+        // Q16 * Q16 is Q32 turns; the low 32 bits are the angle, wrapped to one turn
+        const int64_t reading = i % 2 == 0 ? xq : yq;
+        const auto angle = static_cast<uint32_t>(freq[i] * reading) + phase[i];
+        // linear interpolation between table entries, on the next 10 bits of the angle
+        const uint32_t k = angle >> (32 - sensory::SINE_LUT_BITS);
+        const int32_t frac = (angle >> (22 - sensory::SINE_LUT_BITS)) & 1023;
+        const int32_t s0 = lut[k], s1 = lut[(k + 1) & (sensory::SINE_LUT_SIZE - 1)];
+        const int32_t sine = s0 + ((s1 - s0) * frac >> 10);
+        const auto v = static_cast<int32_t>(
+            std::clamp<int64_t>(static_cast<int64_t>(sine) * multiplier >> 8, -32767, 32767));
+        o[i] = static_cast<int8_t>(v * 127 / 32767);
+      }
+    }
+  }
+
+private:
+  std::array<int32_t, features> freq{};
+  std::array<uint32_t, features> phase{};
+  int32_t multiplier = 256; // Q8
+};
+
+// Population code for a scalar reading (e.g. a distance): `features` Gaussian tuning curves with
+// centers spread evenly over [min, max], each outputting 127 * exp(-((v - center) / width)^2 / 2)
+template <int features> class PopulationEncoder {
+public:
+  PopulationEncoder(float min, float max, float width)
+      : min(min), scale(sensory::GAUSSIAN_LUT_SCALE / width) {
+    for (int k = 0; k < features; ++k) {
+      const float center = features > 1 ? (max - min) * k / (features - 1) : 0.0f;
+      centers[k] = static_cast<int32_t>(std::lround(center * scale));
+    }
+  }
+
+  // out[n * features + k] gets curve k of creature n
+  void encode(std::span<const float> values, std::span<int8_t> out) const {
+    const int8_t *lut = sensory::gaussian_lut().data();
+    const int count = static_cast<int>(values.size());
+#pragma omp parallel for schedule(static) if (count > 256)
+    for (int n = 0; n < count; ++n) {
+      // reading in LUT steps from min
+      const auto v = static_cast<int32_t>(
+          std::clamp((values[n] - min) * scale, -1e6f, 1e6f));
+      int8_t *o = &out[static_cast<std::size_t>(n) * features];
+#pragma omp simd
+      for (int k = 0; k < features; ++k) {
+        const int32_t d = std::min(std::abs(v - centers[k]), sensory::GAUSSIAN_LUT_SIZE - 1);
+        o[k] = lut[d];
+      }
+    }
+  }
+
+private:
+  float min;
+  float scale; // LUT steps per unit
+  std::array<int32_t, features> centers{};
+};
+
+// Encoded inputs for one tick. every consumer in a tick (network update, rendering, recording)
+// reads the same buffer, and the encoder only runs the first time a tick asks for it.
+class SensoryFrame {
+public:
+  template <typename Encode>
+  std::span<const int8_t> get(uint64_t tick, std::size_t size, Encode &&encode) {
+    if (tick != m_tick || inputs.size() != size) {
+      inputs.resize(size);
+      encode(std::span<int8_t>(inputs));
+      m_tick = tick;
+    }
+    return inputs;
+  }
+
+  void invalidate() {
+    m_tick = ~uint64_t{0};
+  }
+
+private:
+  uint64_t m_tick = ~uint64_t{0};
+  std::vector<int8_t> inputs;
+};
@@ -2,28 +2,216 @@
 
 #include <algorithm>
 #include <array>
+#include <bit>
+#include <cmath>
 #include <cstdint>
 #include <iostream>
 #include <limits>
 #include <random>
 #include <span>
+#include <type_traits>
 #include <vector>
 
+#include "snn_simd.h"
+
 namespace {
 using std::array;
 using std::int16_t;
 using std::int8_t;
 using std::uint16_t;
+using std::uint64_t;
 using std::uint8_t;
 }; // namespace
 
-template <int inputs, int hidden, int outputs> struct SNN {
-  array<int8_t, hidden * inputs> w_hidden_input;
-  array<int8_t, hidden * hidden> w_hidden_hidden;
-  array<int8_t, outputs * hidden> w_output_hidden;
+// number of 64-bit words needed for one bit per neuron
+constexpr int spike_words(int neurons) {
+  return (neurons + 63) / 64;
+}
+
+// Step stages shared by every SNN variant. they work on raw arrays so dense, sparse and
+// arena-backed networks all run the same arithmetic. sizes are plain arguments: callers with
+// compile-time sizes pass constants and the loops get specialized after inlining.
+namespace snn_kernels {
+
+constexpr uint8_t LEAK_SHIFT = 4; // leak rate
+constexpr int THRESHOLD = std::numeric_limits<uint8_t>::max();
+
+// writes the indices of the neurons set in act to spikes, in ascending order, and returns how many
+// there are
+inline int collect_spikes(int hidden, const uint64_t *act, uint16_t *spikes) {
+  int count = 0;
+  for (auto w = 0; w < spike_words(hidden); ++w) {
+    for (uint64_t bits = act[w]; bits != 0; bits &= bits - 1) {
+      spikes[count++] = static_cast<uint16_t>(w * 64 + std::countr_zero(bits));
+    }
+  }
+  return count;
+}
+
+// leak and bias
+inline void integrate_state(int hidden, const uint8_t *s_hidden, const uint8_t *b_hidden,
+                            int16_t *acc) {
+  for (auto i = 0; i < hidden; ++i) {
+    // start with current accumulated hidden state
+    int16_t a = s_hidden[i];
+    // apply leak
+    a -= static_cast<uint8_t>(a) >> LEAK_SHIFT;
+    // add bias
+    a += b_hidden[i];
+    acc[i] = a;
+  }
+}
+
+// leak, bias and input projection
+template <int inputs, int hidden>
+void integrate_inputs(const uint8_t *s_hidden, const uint8_t *b_hidden,
+                      const int8_t *w_hidden_input, const int8_t *input, int16_t *acc) {
+  integrate_state(hidden, s_hidden, b_hidden, acc);
+  snn_simd::project_inputs<inputs, hidden>(w_hidden_input, input, acc);
+}
+
+inline void integrate_inputs(int inputs, int hidden, const uint8_t *s_hidden,
+                             const uint8_t *b_hidden, const int8_t *w_hidden_input,
+                             const int8_t *input, int16_t *acc) {
+  integrate_state(hidden, s_hidden, b_hidden, acc);
+  snn_simd::project_inputs_scalar(inputs, hidden, w_hidden_input, input, acc);
+}
+
+// adds the weight column of every neuron in spikes. columns are hidden long
+inline void accumulate_columns(int hidden, const int8_t *w_hidden_hidden, const uint16_t *spikes,
+                               int spike_count, int16_t *acc) {
+  for (auto s = 0; s < spike_count; ++s) {
+    const int8_t *column = &w_hidden_hidden[spikes[s] * hidden];
+    for (auto i = 0; i < hidden; ++i) {
+      acc[i] = static_cast<int16_t>(acc[i] + column[i]);
+    }
+  }
+}
+
+// spike, reset and store the new state
+inline void fire(int hidden, const int16_t *acc, uint8_t *s_hidden, uint64_t *act_hidden) {
+  std::fill(act_hidden, act_hidden + spike_words(hidden), 0);
+  for (auto i = 0; i < hidden; ++i) {
+    // check if the neuron spikes
+    if (acc[i] >= THRESHOLD) {
+      act_hidden[i / 64] |= uint64_t{1} << (i % 64);
+    }
+
+    // update the state
+    s_hidden[i] = static_cast<uint8_t>(acc[i]);
+    if (acc[i] >= THRESHOLD || acc[i] < 0) {
+      s_hidden[i] = 0;
+    }
+  }
+}
+
+// output[j] = sum of w_output_hidden[i * outputs + j] over the neurons i in spikes
+inline void read_outputs(int outputs, const int8_t *w_output_hidden, const uint16_t *spikes,
+                         int spike_count, int16_t *output) {
+  std::fill(output, output + outputs, 0);
+  for (auto s = 0; s < spike_count; ++s) {
+    const int8_t *column = &w_output_hidden[spikes[s] * outputs];
+    for (auto j = 0; j < outputs; ++j) {
+      output[j] += column[j];
+    }
+  }
+}
+
+} // namespace snn_kernels
+
+// Hidden->hidden weights sliced into bit-planes, the way the recurrent stage is built in FPGA
+// logic: plane b of postsynaptic neuron i holds bit b of every weight j -> i. the recurrent input to i is
+// then sum_b popcount(act & plane[b][i]) << b, with plane 7 (the int8 sign bit) subtracted.
+// this is a packed copy, re-pack after changing w_hidden_hidden.
+template <int hidden> struct SNNBitPlanes {
+  static constexpr int WORDS = spike_words(hidden);
+  // [bit][postsynaptic neuron][word]
+  array<uint64_t, 8 * hidden * WORDS> planes;
+
+  // w is in SNN::w_hidden_hidden layout (w[j * hidden + i] is j -> i)
+  void pack(const array<int8_t, hidden * hidden> &w) {
+    std::fill(planes.begin(), planes.end(), 0);
+    for (auto j = 0; j < hidden; ++j) {
+      for (auto i = 0; i < hidden; ++i) {
+        const auto bits = static_cast<uint8_t>(w[j * hidden + i]);
+        for (auto b = 0; b < 8; ++b) {
+          if ((bits >> b) & 1) {
+            planes[(b * hidden + i) * WORDS + j / 64] |= uint64_t{1} << (j % 64);
+          }
+        }
+      }
+    }
+  }
+
+  // recurrent input to neuron i given last step's activations
+  int recurrent(const array<uint64_t, WORDS> &act, int i) const {
+    int sum = 0;
+    for (auto b = 0; b < 8; ++b) {
+      const uint64_t *plane = &planes[(b * hidden + i) * WORDS];
+      int count = 0;
+      for (auto w = 0; w < WORDS; ++w) {
+        count += std::popcount(act[w] & plane[w]);
+      }
+      // bit 7 of a two's complement int8 is worth -128
+      sum += b == 7 ? -(count << 7) : count << b;
+    }
+    return sum;
+  }
+};
+
+// rows x columns int4 weights packed two per byte (see snn_simd::int4_at), each row starting on a
+// byte. element k is row k / columns, column k % columns, the same indexing as the int8 arrays.
+template <int rows, int columns> struct PackedInt4 {
+  static constexpr int STRIDE = snn_simd::int4_stride(columns);
+  array<uint8_t, rows * STRIDE> bytes;
+
+  static constexpr std::size_t size() {
+    return static_cast<std::size_t>(rows) * columns;
+  }
+  const uint8_t *row(int r) const {
+    return &bytes[r * STRIDE];
+  }
+  int8_t get(int k) const {
+    return static_cast<int8_t>(snn_simd::int4_at(row(k / columns), k % columns));
+  }
+  // v is clamped to [-8, 7]
+  void set(int k, int v) {
+    uint8_t &b = bytes[(k / columns) * STRIDE + (k % columns) / 2];
+    const int shift = 4 * (k % columns % 2);
+    b = static_cast<uint8_t>((b & ~(0xf << shift)) | ((std::clamp(v, -8, 7) & 0xf) << shift));
+  }
+  bool operator==(const PackedInt4 &) const = default;
+};
+
+template <int rows, int columns, int bits>
+using SNNWeights =
+    std::conditional_t<bits == 4, PackedInt4<rows, columns>, array<int8_t, rows * columns>>;
+
+// nearest int4 weight to an int8 weight, in units of 1 << INT4_SHIFT
+constexpr int quantize_int4(int w) {
+  return std::clamp((w + (1 << (snn_simd::INT4_SHIFT - 1))) >> snn_simd::INT4_SHIFT, -8, 7);
+}
+
+// weight_bits is 8 (int8 weights) or 4 (packed int4 weights, half the memory). an int4 weight w has
+// the effect of the int8 weight w << 4, so an int4 network steps exactly like the int8 network
+// to_int8() makes from it. biases and state are 8 bit either way.
+template <int inputs, int hidden, int outputs, int weight_bits = 8> struct SNN {
+  static_assert(weight_bits == 8 || weight_bits == 4, "weights are int8 or packed int4");
+
+  SNNWeights<hidden, inputs, weight_bits> w_hidden_input;
+  // recurrent and output weights are stored per presynaptic neuron (w_hidden_hidden[j * hidden + i]
+  // is j -> i, w_output_hidden[i * outputs + j] is hidden i -> output j), so a spike adds one
+  // contiguous column
+  SNNWeights<hidden, hidden, weight_bits> w_hidden_hidden;
+  SNNWeights<hidden, outputs, weight_bits> w_output_hidden;
   array<uint8_t, hidden> b_hidden;
   array<uint8_t, hidden> s_hidden;
-  array<bool, hidden> act_hidden;
+  // one bit per neuron, bit i % 64 of word i / 64. read with spiked()
+  array<uint64_t, spike_words(hidden)> act_hidden;
+
+  bool spiked(int i) const {
+    return (act_hidden[i / 64] >> (i % 64)) & 1;
+  }
 
   void init(std::mt19937 &rng) {
     // He/Xavier-inspired initialization scaled for uint8_t/int8_t ranges
@@ -49,12 +237,19 @@ template <int inputs, int hidden, int outputs> struct SNN {
     // Bias: small positive values
     std::uniform_int_distribution<int> dist_bias(input_range / 2, input_range);
 
-    for (auto &w : w_hidden_input)
-      w = static_cast<uint8_t>(dist_input(rng));
-    for (auto &w : w_hidden_hidden)
-      w = static_cast<uint8_t>(dist_hidden(rng));
-    for (auto &w : w_output_hidden)
-      w = static_cast<int8_t>(dist_output(rng));
+    // int4 weights get the nearest value to the int8 draw
+    const auto fill = [&](auto &weights, auto &dist) {
+      for (std::size_t k = 0; k < weights.size(); ++k) {
+        if constexpr (weight_bits == 8) {
+          weights[k] = static_cast<int8_t>(dist(rng));
+        } else {
+          weights.set(static_cast<int>(k), quantize_int4(dist(rng)));
+        }
+      }
+    };
+    fill(w_hidden_input, dist_input);
+    fill(w_hidden_hidden, dist_hidden);
+    fill(w_output_hidden, dist_output);
     for (auto &b : b_hidden)
       b = static_cast<uint8_t>(dist_bias(rng));
 
@@ -63,69 +258,108 @@ template <int inputs, int hidden, int outputs> struct SNN {
 
   void clear() {
     std::fill(s_hidden.begin(), s_hidden.end(), 0);
-    std::fill(act_hidden.begin(), act_hidden.end(), false);
+    std::fill(act_hidden.begin(), act_hidden.end(), 0);
+  }
+
+  // writes the indices of the neurons that spiked last step to spikes, in ascending order, and
+  // returns how many there are
+  int collect_spikes(array<uint16_t, hidden> &spikes) const {
+    return snn_kernels::collect_spikes(hidden, act_hidden.data(), spikes.data());
   }
 
   void update(std::span<int8_t const> input) {
-    static constexpr uint8_t LEAK_SHIFT = 4; // leak rate
-    static constexpr int THRESHOLD = std::numeric_limits<uint8_t>::max();
-    array<bool, hidden> act_hidden_next;
+    // int16 wraps the same no matter what order terms are added in, so the recurrent term can be
+    // accumulated per spike after the inputs
+    array<int16_t, hidden> acc;
+    integrate_inputs(input, acc);
 
-    for (auto i = 0; i < hidden; ++i) {
-      // start with current accumulated hidden state
-      int16_t acc = s_hidden[i];
-      // apply leak
-      acc -= static_cast<uint8_t>(acc) >> LEAK_SHIFT;
-      // add bias
-      acc += b_hidden[i];
-      // add inputs
-      for (auto j = 0; j < inputs; ++j) {
-        acc += (static_cast<int16_t>(w_hidden_input[i * inputs + j]) *
-                    static_cast<int16_t>(input[j]) >>
-                8);
+    // add recurrent connections, one weight column per neuron that spiked last step
+    array<uint16_t, hidden> spikes;
+    const int spike_count = collect_spikes(spikes);
+    if constexpr (weight_bits == 8) {
+      snn_kernels::accumulate_columns(hidden, w_hidden_hidden.data(), spikes.data(), spike_count,
+                                      acc.data());
+    } else {
+      for (auto s = 0; s < spike_count; ++s) {
+        snn_simd::accumulate_int4(hidden, w_hidden_hidden.row(spikes[s]), acc.data());
       }
+    }
 
-      // std::cout << "after inputs: " << (int)acc << std::endl;
-      // add recurrent connections
-      for (auto j = 0; j < hidden; ++j) {
-        if (act_hidden[j]) {
-          acc += w_hidden_hidden[i * hidden + j];
-        }
-      }
+    fire(acc);
+  }
 
-      // check if the neuron spikes
-      act_hidden_next[i] = acc >= THRESHOLD;
-      // std::cout << (int)acc << std::endl;
+  // same step, with the recurrent term computed from bit-planes packed from w_hidden_hidden.
+  // cost is independent of how many neurons spiked.
+  void update(std::span<int8_t const> input, const SNNBitPlanes<hidden> &planes)
+    requires(weight_bits == 8)
+  {
+    array<int16_t, hidden> acc;
+    integrate_inputs(input, acc);
+    for (auto i = 0; i < hidden; ++i) {
+      acc[i] = static_cast<int16_t>(acc[i] + planes.recurrent(act_hidden, i));
+    }
+    fire(acc);
+  }
 
-      // update the state
-      s_hidden[i] = static_cast<uint8_t>(acc);
-      if (acc >= THRESHOLD || acc < 0) {
-        s_hidden[i] = 0;
-      }
-      // if (acc < 0) {
-      //   s_hidden[i] = 0;
-      // }
+  // leak, bias and input projection
+  void integrate_inputs(std::span<int8_t const> input, array<int16_t, hidden> &acc) const {
+    if constexpr (weight_bits == 8) {
+      snn_kernels::integrate_inputs<inputs, hidden>(
+          s_hidden.data(), b_hidden.data(), w_hidden_input.data(), input.data(), acc.data());
+    } else {
+      snn_kernels::integrate_state(hidden, s_hidden.data(), b_hidden.data(), acc.data());
+      snn_simd::project_inputs_int4<inputs, hidden>(w_hidden_input.bytes.data(), input.data(),
+                                                    acc.data());
     }
-    // copy over new activations
-    act_hidden = act_hidden_next;
+  }
 
-    // for (auto i = 0; i < hidden; ++i) {
-    //   std::cout << (int)s_hidden[i] << " ";
-    // }
-    // std::cout << std::endl;
+  // spike, reset and store the new state
+  void fire(const array<int16_t, hidden> &acc) {
+    snn_kernels::fire(hidden, acc.data(), s_hidden.data(), act_hidden.data());
   }
 
   void get_output(std::vector<int16_t> &output) {
     output.resize(outputs);
-    // init to all zeros
-    std::fill(output.begin(), output.end(), 0);
-    for (auto j = 0; j < outputs; ++j) {
-      for (auto i = 0; i < hidden; ++i) {
-        // after a spike, the s_hidden is 0
-        if (act_hidden[i]) {
-          output[j] += w_output_hidden[j * hidden + i];
-        }
+    // after a spike, the s_hidden is 0
+    array<uint16_t, hidden> spikes;
+    const int spike_count = collect_spikes(spikes);
+    if constexpr (weight_bits == 8) {
+      snn_kernels::read_outputs(outputs, w_output_hidden.data(), spikes.data(), spike_count,
+                                output.data());
+    } else {
+      std::fill(output.begin(), output.end(), 0);
+      for (auto s = 0; s < spike_count; ++s) {
+        snn_simd::accumulate_int4(outputs, w_output_hidden.row(spikes[s]), output.data());
       }
     }
   }
 };
+
+// int4 copy of an int8 network, weights rounded to the nearest int4 value
+template <int inputs, int hidden, int outputs>
+void to_int4(const SNN<inputs, hidden, outputs> &net, SNN<inputs, hidden, outputs, 4> &out) {
+  for (auto k = 0; k < hidden * inputs; ++k)
+    out.w_hidden_input.set(k, quantize_int4(net.w_hidden_input[k]));
+  for (auto k = 0; k < hidden * hidden; ++k)
+    out.w_hidden_hidden.set(k, quantize_int4(net.w_hidden_hidden[k]));
+  for (auto k = 0; k < hidden * outputs; ++k)
+    out.w_output_hidden.set(k, quantize_int4(net.w_output_hidden[k]));
+  out.b_hidden = net.b_hidden;
+  out.s_hidden = net.s_hidden;
+  out.act_hidden = net.act_hidden;
+}
+
+// the int8 network an int4 network behaves as
+template <int inputs, int hidden, int outputs>
+void to_int8(const SNN<inputs, hidden, outputs, 4> &net, SNN<inputs, hidden, outputs> &out) {
+  const auto expand = [](int8_t w) { return static_cast<int8_t>(w << snn_simd::INT4_SHIFT); };
+  for (auto k = 0; k < hidden * inputs; ++k)
+    out.w_hidden_input[k] = expand(net.w_hidden_input.get(k));
+  for (auto k = 0; k < hidden * hidden; ++k)
+    out.w_hidden_hidden[k] = expand(net.w_hidden_hidden.get(k));
+  for (auto k = 0; k < hidden * outputs; ++k)
+    out.w_output_hidden[k] = expand(net.w_output_hidden.get(k));
+  out.b_hidden = net.b_hidden;
+  out.s_hidden = net.s_hidden;
+  out.act_hidden = net.act_hidden;
+}
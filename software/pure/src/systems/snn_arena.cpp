@@ -0,0 +1,239 @@
+#include "snn_arena.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+std::size_t weight_count(const SNNShape &s) {
+  return static_cast<std::size_t>(s.hidden) * (s.inputs + s.hidden + s.outputs);
+}
+
+// one step of SNN::update for a shape known at compile time. scratch lives on the stack
+template <SNNShape shape>
+void step_compiled(const SNNShape &, const int8_t *weights, const uint8_t *b_hidden,
+                   uint8_t *s_hidden, uint64_t *act_hidden, const int8_t *input) {
+  constexpr int inputs = shape.inputs, hidden = shape.hidden;
+  std::array<int16_t, hidden> acc;
+  std::array<uint16_t, hidden> spikes;
+  snn_kernels::integrate_inputs<inputs, hidden>(s_hidden, b_hidden, weights, input, acc.data());
+  const int spike_count = snn_kernels::collect_spikes(hidden, act_hidden, spikes.data());
+  snn_kernels::accumulate_columns(hidden, weights + hidden * inputs, spikes.data(), spike_count,
+                                  acc.data());
+  snn_kernels::fire(hidden, acc.data(), s_hidden, act_hidden);
+}
+
+// the same step for any shape. scratch is per thread and only grows
+void step_generic(const SNNShape &shape, const int8_t *weights, const uint8_t *b_hidden,
+                  uint8_t *s_hidden, uint64_t *act_hidden, const int8_t *input) {
+  thread_local std::vector<int16_t> acc;
+  thread_local std::vector<uint16_t> spikes;
+  const int inputs = shape.inputs, hidden = shape.hidden;
+  if (acc.size() < static_cast<std::size_t>(hidden)) {
+    acc.resize(hidden);
+    spikes.resize(hidden);
+  }
+  snn_kernels::integrate_inputs(inputs, hidden, s_hidden, b_hidden, weights, input, acc.data());
+  const int spike_count = snn_kernels::collect_spikes(hidden, act_hidden, spikes.data());
+  snn_kernels::accumulate_columns(hidden, weights + hidden * inputs, spikes.data(), spike_count,
+                                  acc.data());
+  snn_kernels::fire(hidden, acc.data(), s_hidden, act_hidden);
+}
+
+template <std::size_t... indices>
+constexpr std::array<SNNArena::Step, sizeof...(indices)>
+make_kernels(std::index_sequence<indices...>) {
+  return {&step_compiled<SNNArena::COMPILED_SHAPES[indices]>...};
+}
+
+constexpr auto KERNELS =
+    make_kernels(std::make_index_sequence<std::size(SNNArena::COMPILED_SHAPES)>{});
+
+SNNArena::Step select_kernel(const SNNShape &shape) {
+  for (std::size_t k = 0; k < KERNELS.size(); ++k) {
+    if (SNNArena::COMPILED_SHAPES[k] == shape) {
+      return KERNELS[k];
+    }
+  }
+  return &step_generic;
+}
+
+} // namespace
+
+SNNArena::Slot SNNArena::allocate(SNNShape shape) {
+  Slot slot{shape, weights.size(), neurons.size(), act_hidden.size(), m_input_size,
+            select_kernel(shape)};
+  weights.resize(weights.size() + weight_count(shape), 0);
+  neurons.resize(neurons.size() + 2 * shape.hidden, 0);
+  act_hidden.resize(act_hidden.size() + spike_words(shape.hidden), 0);
+  return slot;
+}
+
+int SNNArena::add(SNNShape shape) {
+  slots.push_back(allocate(shape));
+  m_input_size += shape.inputs;
+  return size() - 1;
+}
+
+void SNNArena::reshape(int n, SNNShape shape) {
+  const SNNShape old = slots[n].shape;
+  if (old == shape) {
+    clear(n);
+    return;
+  }
+
+  Slot slot = allocate(shape);
+  slot.input = slots[n].input;
+  const int hidden = std::min(old.hidden, shape.hidden);
+  const int inputs = std::min(old.inputs, shape.inputs);
+  const int outputs = std::min(old.outputs, shape.outputs);
+  const int8_t *src = &weights[slots[n].weights];
+  int8_t *dst = &weights[slot.weights];
+  for (int i = 0; i < hidden; ++i) {
+    std::copy_n(&src[i * old.inputs], inputs, &dst[i * shape.inputs]);
+  }
+  src += old.hidden * old.inputs;
+  dst += shape.hidden * shape.inputs;
+  for (int j = 0; j < hidden; ++j) {
+    std::copy_n(&src[j * old.hidden], hidden, &dst[j * shape.hidden]);
+  }
+  src += old.hidden * old.hidden;
+  dst += shape.hidden * shape.hidden;
+  for (int i = 0; i < hidden; ++i) {
+    std::copy_n(&src[i * old.outputs], outputs, &dst[i * shape.outputs]);
+  }
+  std::copy_n(&neurons[slots[n].neurons], hidden, &neurons[slot.neurons]);
+  slots[n] = slot;
+
+  // inputs are packed in network order, so everything after n moves
+  if (shape.inputs != old.inputs) {
+    for (auto k = n + 1; k < size(); ++k) {
+      slots[k].input += shape.inputs - old.inputs;
+    }
+    m_input_size += shape.inputs - old.inputs;
+  }
+}
+
+void SNNArena::compact() {
+  std::vector<int8_t> packed_weights;
+  std::vector<uint8_t> packed_neurons;
+  std::vector<uint64_t> packed_act;
+  packed_weights.reserve(weights.size());
+  packed_neurons.reserve(neurons.size());
+  packed_act.reserve(act_hidden.size());
+  for (auto &slot : slots) {
+    const auto w = weights.begin() + slot.weights;
+    const auto b = neurons.begin() + slot.neurons;
+    const auto a = act_hidden.begin() + slot.act;
+    slot.weights = packed_weights.size();
+    slot.neurons = packed_neurons.size();
+    slot.act = packed_act.size();
+    packed_weights.insert(packed_weights.end(), w, w + weight_count(slot.shape));
+    packed_neurons.insert(packed_neurons.end(), b, b + 2 * slot.shape.hidden);
+    packed_act.insert(packed_act.end(), a, a + spike_words(slot.shape.hidden));
+  }
+  weights = std::move(packed_weights);
+  neurons = std::move(packed_neurons);
+  act_hidden = std::move(packed_act);
+}
+
+void SNNArena::reserve(int networks, std::size_t weight_bytes) {
+  slots.reserve(networks);
+  weights.reserve(weight_bytes);
+}
+
+bool SNNArena::compiled(int n) const {
+  return slots[n].step != &step_generic;
+}
+
+std::size_t SNNArena::bytes() const {
+  return weights.size() + neurons.size() + act_hidden.size() * sizeof(uint64_t);
+}
+
+void SNNArena::init(int n, std::mt19937 &rng) {
+  const SNNShape &s = slots[n].shape;
+
+  int input_range = std::clamp(static_cast<int>(64 * std::sqrt(2.0f / s.inputs)), 1, 127);
+  int hidden_range = std::clamp(static_cast<int>(128 * std::sqrt(1.0f / s.hidden)), 1, 127);
+  int output_range = std::clamp(static_cast<int>(128 * std::sqrt(1.0f / s.hidden)), 1, 127);
+  std::uniform_int_distribution<int> dist_input(-input_range, input_range);
+  std::uniform_int_distribution<int> dist_hidden(-hidden_range, hidden_range);
+  std::uniform_int_distribution<int> dist_output(-output_range, output_range);
+  std::uniform_int_distribution<int> dist_bias(input_range / 2, input_range);
+
+  for (auto &w : w_hidden_input(n))
+    w = static_cast<int8_t>(dist_input(rng));
+  for (auto &w : w_hidden_hidden(n))
+    w = static_cast<int8_t>(dist_hidden(rng));
+  for (auto &w : w_output_hidden(n))
+    w = static_cast<int8_t>(dist_output(rng));
+  for (auto &b : b_hidden(n))
+    b = static_cast<uint8_t>(dist_bias(rng));
+
+  clear(n);
+}
+
+void SNNArena::clear(int n) {
+  std::fill_n(&neurons[slots[n].neurons + slots[n].shape.hidden], slots[n].shape.hidden, 0);
+  std::fill_n(&act_hidden[slots[n].act], spike_words(slots[n].shape.hidden), 0);
+}
+
+void SNNArena::update(int n, std::span<int8_t const> input) {
+  const Slot &slot = slots[n];
+  slot.step(slot.shape, &weights[slot.weights], &neurons[slot.neurons],
+            &neurons[slot.neurons + slot.shape.hidden], &act_hidden[slot.act], input.data());
+}
+
+void SNNArena::update(std::span<int8_t const> input) {
+  const int count = size();
+#pragma omp parallel for schedule(dynamic, 16)
+  for (int n = 0; n < count; ++n) {
+    update(n, input.subspan(slots[n].input, slots[n].shape.inputs));
+  }
+}
+
+void SNNArena::get_output(int n, std::vector<int16_t> &output) const {
+  const Slot &slot = slots[n];
+  const int hidden = slot.shape.hidden;
+  output.resize(slot.shape.outputs);
+  thread_local std::vector<uint16_t> spikes;
+  spikes.resize(std::max(spikes.size(), static_cast<std::size_t>(hidden)));
+  const int spike_count = snn_kernels::collect_spikes(hidden, &act_hidden[slot.act], spikes.data());
+  snn_kernels::read_outputs(slot.shape.outputs,
+                            &weights[slot.weights + hidden * (slot.shape.inputs + hidden)],
+                            spikes.data(), spike_count, output.data());
+}
+
+std::span<int8_t> SNNArena::w_hidden_input(int n) {
+  const Slot &slot = slots[n];
+  return {&weights[slot.weights], static_cast<std::size_t>(slot.shape.hidden * slot.shape.inputs)};
+}
+
+std::span<int8_t> SNNArena::w_hidden_hidden(int n) {
+  const Slot &slot = slots[n];
+  const int hidden = slot.shape.hidden;
+  return {&weights[slot.weights + hidden * slot.shape.inputs],
+          static_cast<std::size_t>(hidden * hidden)};
+}
+
+std::span<int8_t> SNNArena::w_output_hidden(int n) {
+  const Slot &slot = slots[n];
+  const int hidden = slot.shape.hidden;
+  return {&weights[slot.weights + hidden * (slot.shape.inputs + hidden)],
+          static_cast<std::size_t>(hidden * slot.shape.outputs)};
+}
+
+std::span<uint8_t> SNNArena::b_hidden(int n) {
+  return {&neurons[slots[n].neurons], static_cast<std::size_t>(slots[n].shape.hidden)};
+}
+
+std::span<uint8_t> SNNArena::s_hidden(int n) {
+  return {&neurons[slots[n].neurons + slots[n].shape.hidden],
+          static_cast<std::size_t>(slots[n].shape.hidden)};
+}
+
+std::span<uint64_t> SNNArena::act(int n) {
+  return {&act_hidden[slots[n].act], static_cast<std::size_t>(spike_words(slots[n].shape.hidden))};
+}
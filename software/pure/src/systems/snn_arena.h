@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "snn.h"
+
+struct SNNShape {
+  int inputs;
+  int hidden;
+  int outputs;
+
+  bool operator==(const SNNShape &) const = default;
+};
+
+// Runtime-sized SNNs with every network's weights and state packed into a few contiguous arrays
+// owned by the arena, so a world of creatures with different brain sizes costs no allocation per
+// creature. networks are referred to by the index add() returns.
+// each network is stepped by a kernel picked once when it is added: shapes listed in
+// SNNArena::COMPILED_SHAPES run the same fully specialized code as SNN<inputs, hidden, outputs>,
+// any other shape runs a generic kernel. both are bit-identical to SNN::update.
+// weights use SNN's layout (recurrent and output weights stored per presynaptic neuron).
+class SNNArena {
+public:
+  static constexpr SNNShape COMPILED_SHAPES[] = {
+      {16, 32, 8}, {16, 64, 8}, {32, 64, 16}, {32, 128, 16}, {64, 256, 16}};
+
+  // adds a zeroed network and returns its index
+  int add(SNNShape shape);
+  // changes a network's shape, e.g. to add or remove neurons. weights between neurons that exist in
+  // both shapes are kept, new ones are zero, and the state is cleared. the old storage is only
+  // reclaimed by compact()
+  void reshape(int n, SNNShape shape);
+  // drops storage orphaned by reshape. indices stay valid
+  void compact();
+  void reserve(int networks, std::size_t weight_bytes);
+
+  int size() const {
+    return static_cast<int>(slots.size());
+  }
+  const SNNShape &shape(int n) const {
+    return slots[n].shape;
+  }
+  // true if network n runs a compile-time specialized kernel
+  bool compiled(int n) const;
+  // arena storage in bytes, including anything orphaned by reshape
+  std::size_t bytes() const;
+
+  // same ranges as SNN::init
+  void init(int n, std::mt19937 &rng);
+  void clear(int n);
+  template <int inputs, int hidden, int outputs>
+  void load(int n, const SNN<inputs, hidden, outputs> &net);
+
+  void update(int n, std::span<int8_t const> input);
+  // steps every network. input holds input_size() values, network n's at input_offset(n)
+  void update(std::span<int8_t const> input);
+  int input_offset(int n) const {
+    return slots[n].input;
+  }
+  int input_size() const {
+    return m_input_size;
+  }
+  void get_output(int n, std::vector<int16_t> &output) const;
+
+  bool spiked(int n, int i) const {
+    return (act_hidden[slots[n].act + i / 64] >> (i % 64)) & 1;
+  }
+
+  // views into network n's storage
+  std::span<int8_t> w_hidden_input(int n);
+  std::span<int8_t> w_hidden_hidden(int n);
+  std::span<int8_t> w_output_hidden(int n);
+  std::span<uint8_t> b_hidden(int n);
+  std::span<uint8_t> s_hidden(int n);
+  std::span<uint64_t> act(int n);
+
+  using Step = void (*)(const SNNShape &shape, const int8_t *weights, const uint8_t *b_hidden,
+                        uint8_t *s_hidden, uint64_t *act_hidden, const int8_t *input);
+
+private:
+  struct Slot {
+    SNNShape shape;
+    std::size_t weights; // w_hidden_input, then w_hidden_hidden, then w_output_hidden
+    std::size_t neurons; // b_hidden, then s_hidden
+    std::size_t act;
+    int input;
+    Step step;
+  };
+
+  std::vector<Slot> slots;
+  std::vector<int8_t> weights;
+  std::vector<uint8_t> neurons;
+  std::vector<uint64_t> act_hidden;
+  int m_input_size = 0;
+
+  Slot allocate(SNNShape shape);
+};
+
+template <int inputs, int hidden, int outputs>
+void SNNArena::load(int n, const SNN<inputs, hidden, outputs> &net) {
+  reshape(n, {inputs, hidden, outputs});
+  std::copy(net.w_hidden_input.begin(), net.w_hidden_input.end(), w_hidden_input(n).begin());
+  std::copy(net.w_hidden_hidden.begin(), net.w_hidden_hidden.end(), w_hidden_hidden(n).begin());
+  std::copy(net.w_output_hidden.begin(), net.w_output_hidden.end(), w_output_hidden(n).begin());
+  std::copy(net.b_hidden.begin(), net.b_hidden.end(), b_hidden(n).begin());
+  std::copy(net.s_hidden.begin(), net.s_hidden.end(), s_hidden(n).begin());
+  std::copy(net.act_hidden.begin(), net.act_hidden.end(), act(n).begin());
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "snn.h"
+
+struct SNNCoreConfig {
+  int neurons_per_cycle = 1; // neuron lanes working in parallel
+  int bram_width = 36;       // data bits per weight BRAM word, at most 72 (RAMB36 in SDP mode)
+  int bram_ports = 1;        // read ports per weight bank. RAMB36 has 2, more means replicas
+  int pipeline_latency = 3;  // cycles from address to accumulate, paid once per phase
+  int scan_bits = 64;        // spike bitmap bits the priority encoder scans per cycle
+};
+
+struct SNNCoreStats {
+  uint64_t steps = 0;
+  uint64_t input_cycles = 0;
+  uint64_t recurrent_cycles = 0;
+  uint64_t fire_cycles = 0;
+  uint64_t output_cycles = 0;
+
+  uint64_t cycles() const {
+    return input_cycles + recurrent_cycles + fire_cycles + output_cycles;
+  }
+  double cycles_per_step() const {
+    return steps > 0 ? static_cast<double>(cycles()) / steps : 0.0;
+  }
+  // steps per second one core sustains at clock_hz
+  double tick_rate(double clock_hz) const {
+    return steps > 0 ? clock_hz / cycles_per_step() : 0.0;
+  }
+};
+
+// Cycle-level model of a time-multiplexed SNN core, for sizing the FPGA implementation.
+// the core has neurons_per_cycle lanes; lane l owns hidden neurons l, l + lanes, ... and has its
+// own input and recurrent weight banks, so lanes never contend. weights sit in BRAM words of
+// bram_width / 8 int8 weights, every row padded to whole words. per step:
+// - input: each lane reads its neuron's input row, bram_ports words per cycle, one neuron at a time
+// - recurrent: the priority encoder scans last step's spike bitmap scan_bits per cycle; for every
+//   spike each lane reads its slice of that neuron's outgoing column
+// - fire: each lane leaks/thresholds/resets one neuron per cycle
+// - output (on get_output): one shared bank, each spike reads its output row
+// each phase pays pipeline_latency once. the arithmetic is SNN's, done on words read from the
+// modeled memories, so spikes, state and outputs are bit-identical to SNN::update.
+template <int inputs, int hidden, int outputs> class SNNCoreModel {
+public:
+  using Network = SNN<inputs, hidden, outputs>;
+
+  explicit SNNCoreModel(const SNNCoreConfig &config)
+      : config(config), lanes(std::clamp(config.neurons_per_cycle, 1, hidden)),
+        width(std::clamp(config.bram_width, 8, 72)), per_word(width / 8),
+        ports(std::max(config.bram_ports, 1)), scan_bits(std::max(config.scan_bits, 1)),
+        neurons_per_lane((hidden + lanes - 1) / lanes), input_words(words(inputs)),
+        column_words(words(neurons_per_lane)), output_words(words(outputs)),
+        input_bank(lanes, std::vector<int8_t>(neurons_per_lane * input_words * per_word, 0)),
+        recurrent_bank(lanes, std::vector<int8_t>(hidden * column_words * per_word, 0)),
+        output_bank(hidden * output_words * per_word, 0) {}
+
+  // write a network's weights into the banks and copy its state
+  void load(const Network &net) {
+    for (int i = 0; i < hidden; ++i) {
+      const int lane = i % lanes, slot = i / lanes;
+      std::copy_n(&net.w_hidden_input[i * inputs], inputs,
+                  &input_bank[lane][slot * input_words * per_word]);
+      for (int j = 0; j < hidden; ++j) {
+        recurrent_bank[lane][j * column_words * per_word + slot] =
+            net.w_hidden_hidden[j * hidden + i];
+      }
+    }
+    for (int j = 0; j < hidden; ++j) {
+      std::copy_n(&net.w_output_hidden[j * outputs], outputs,
+                  &output_bank[j * output_words * per_word]);
+    }
+    b_hidden = net.b_hidden;
+    s_hidden = net.s_hidden;
+    act_hidden = net.act_hidden;
+  }
+
+  void clear() {
+    s_hidden.fill(0);
+    act_hidden.fill(0);
+  }
+
+  void update(std::span<int8_t const> input) {
+    array<int16_t, hidden> acc;
+
+    // leak and bias go with the first input word, so only the reads are counted
+    snn_kernels::integrate_state(hidden, s_hidden.data(), b_hidden.data(), acc.data());
+    for (int lane = 0; lane < lanes; ++lane) {
+      for (int slot = 0; slot < neurons_per_lane && slot * lanes + lane < hidden; ++slot) {
+        const int i = slot * lanes + lane;
+        for (int word = 0; word < input_words; ++word) {
+          const int8_t *w = read(input_bank[lane], slot * input_words + word);
+          for (int k = 0; k < per_word && word * per_word + k < inputs; ++k) {
+            const int j = word * per_word + k;
+            acc[i] += (static_cast<int16_t>(w[k]) * static_cast<int16_t>(input[j]) >> 8);
+          }
+        }
+      }
+    }
+    m_stats.input_cycles += neurons_per_lane * reads(input_words) + config.pipeline_latency;
+
+    // recurrent, one outgoing column per spike of the last step
+    array<uint16_t, hidden> spikes;
+    const int spike_count = snn_kernels::collect_spikes(hidden, act_hidden.data(), spikes.data());
+    for (int s = 0; s < spike_count; ++s) {
+      const int j = spikes[s];
+      for (int lane = 0; lane < lanes; ++lane) {
+        for (int word = 0; word < column_words; ++word) {
+          const int8_t *w = read(recurrent_bank[lane], j * column_words + word);
+          for (int k = 0; k < per_word; ++k) {
+            const int i = (word * per_word + k) * lanes + lane;
+            if (word * per_word + k < neurons_per_lane && i < hidden) {
+              acc[i] = static_cast<int16_t>(acc[i] + w[k]);
+            }
+          }
+        }
+      }
+    }
+    const int scan_cycles = (hidden + scan_bits - 1) / scan_bits;
+    m_stats.recurrent_cycles +=
+        std::max<uint64_t>(scan_cycles, static_cast<uint64_t>(spike_count) * reads(column_words)) +
+        config.pipeline_latency;
+
+    snn_kernels::fire(hidden, acc.data(), s_hidden.data(), act_hidden.data());
+    m_stats.fire_cycles += neurons_per_lane + config.pipeline_latency;
+    ++m_stats.steps;
+  }
+
+  void get_output(std::vector<int16_t> &output) {
+    output.assign(outputs, 0);
+    array<uint16_t, hidden> spikes;
+    const int spike_count = snn_kernels::collect_spikes(hidden, act_hidden.data(), spikes.data());
+    for (int s = 0; s < spike_count; ++s) {
+      for (int word = 0; word < output_words; ++word) {
+        const int8_t *w = read(output_bank, spikes[s] * output_words + word);
+        for (int k = 0; k < per_word && word * per_word + k < outputs; ++k) {
+          output[word * per_word + k] += w[k];
+        }
+      }
+    }
+    m_stats.output_cycles +=
+        static_cast<uint64_t>(spike_count) * reads(output_words) + config.pipeline_latency;
+  }
+
+  bool spiked(int i) const {
+    return (act_hidden[i / 64] >> (i % 64)) & 1;
+  }
+  uint8_t state(int i) const {
+    return s_hidden[i];
+  }
+
+  const SNNCoreStats &stats() const {
+    return m_stats;
+  }
+
+  // RAMB36 primitives for one network's weight banks, counting replicas for read ports beyond the
+  // 2 a RAMB36 has
+  int bram36() const {
+    const int replicas = (ports + 1) / 2;
+    const int per_lane = primitives(neurons_per_lane * input_words) +
+                         primitives(hidden * column_words);
+    return replicas * (lanes * per_lane + primitives(hidden * output_words));
+  }
+  // weight bits stored, including row padding
+  std::size_t weight_bits() const {
+    return (static_cast<std::size_t>(lanes) *
+                (neurons_per_lane * input_words + hidden * column_words) +
+            hidden * output_words) *
+           per_word * 8;
+  }
+
+private:
+  SNNCoreConfig config;
+  // the config's sizes, clamped to what the hardware can have
+  int lanes, width, per_word, ports, scan_bits, neurons_per_lane;
+  int input_words, column_words, output_words; // BRAM words per row
+  std::vector<std::vector<int8_t>> input_bank;     // [lane][slot][word]
+  std::vector<std::vector<int8_t>> recurrent_bank; // [lane][pre][word], this lane's posts
+  std::vector<int8_t> output_bank;                 // [pre][word]
+  array<uint8_t, hidden> b_hidden{};
+  array<uint8_t, hidden> s_hidden{};
+  array<uint64_t, spike_words(hidden)> act_hidden{};
+  SNNCoreStats m_stats;
+
+  int words(int weights) const {
+    return (weights + per_word - 1) / per_word;
+  }
+  // cycles to read n words from one bank
+  uint64_t reads(int n) const {
+    return (n + ports - 1) / ports;
+  }
+  const int8_t *read(const std::vector<int8_t> &bank, int address) const {
+    return &bank[static_cast<std::size_t>(address) * per_word];
+  }
+  // RAMB36 count for a bank of n words. a RAMB36 is 36 Kbit, at most 72 bits wide, and its depth
+  // is a power of two
+  int primitives(int n) const {
+    const int depth = static_cast<int>(std::bit_floor(static_cast<unsigned>(36864 / width)));
+    return (n + depth - 1) / depth;
+  }
+};
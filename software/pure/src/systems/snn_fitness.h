@@ -0,0 +1,131 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "fourier_features.h"
+#include "snn_population.h"
+
+// What one genome did over an evaluation run
+template <int outputs> struct SNNEvaluation {
+  int steps = 0;
+  std::uint64_t spikes = 0; // hidden neuron spikes over all steps
+  std::array<std::int64_t, outputs> output_sum{};
+  std::array<std::int64_t, outputs> output_sq_sum{};
+  std::array<int16_t, outputs> output_min{};
+  std::array<int16_t, outputs> output_max{};
+
+  // fraction of hidden neuron updates that spiked
+  float firing_rate(int hidden) const {
+    return steps > 0 ? static_cast<float>(spikes) / (static_cast<float>(steps) * hidden) : 0.0f;
+  }
+  float output_mean(int j) const {
+    return steps > 0 ? static_cast<float>(output_sum[j]) / steps : 0.0f;
+  }
+  float output_variance(int j) const {
+    if (steps == 0)
+      return 0.0f;
+    const float mean = output_mean(j);
+    return static_cast<float>(output_sq_sum[j]) / steps - mean * mean;
+  }
+};
+
+// Synthetic input trajectory: a mouse wandering over [0, 1]^2 with some momentum, encoded with
+// the same Fourier features SNNTestScreen feeds its network. steps * inputs values, step-major.
+template <int inputs>
+std::vector<int8_t> fourier_trajectory(const FourierFeatures<inputs> &features, int steps,
+                                       float multiplier, std::mt19937 &rng) {
+  std::vector<int8_t> trajectory(static_cast<std::size_t>(steps) * inputs);
+  std::normal_distribution<float> accel(0.0f, 0.002f);
+  float x = 0.5f, y = 0.5f, vx = 0.0f, vy = 0.0f;
+  for (int step = 0; step < steps; ++step) {
+    vx = std::clamp(vx * 0.95f + accel(rng), -0.02f, 0.02f);
+    vy = std::clamp(vy * 0.95f + accel(rng), -0.02f, 0.02f);
+    x += vx;
+    y += vy;
+    // bounce off the edges
+    if (x < 0.0f || x > 1.0f) {
+      vx = -vx;
+      x = std::clamp(x, 0.0f, 1.0f);
+    }
+    if (y < 0.0f || y > 1.0f) {
+      vy = -vy;
+      y = std::clamp(y, 0.0f, 1.0f);
+    }
+    const std::size_t offset = static_cast<std::size_t>(step) * inputs;
+    features.encode(x, y, multiplier, std::span<int8_t>(&trajectory[offset], inputs));
+  }
+  return trajectory;
+}
+
+// Headless evaluation of many genomes on one input trajectory. every genome starts from a cleared
+// state and sees the same inputs; networks are stepped together in an SNNPopulation, so the work
+// is spread over SIMD lanes and OpenMP threads. the population is kept between calls, so
+// evaluating one generation after another doesn't reallocate it.
+template <int inputs, int hidden, int outputs> class SNNFitnessHarness {
+public:
+  using Network = SNN<inputs, hidden, outputs>;
+  using Evaluation = SNNEvaluation<outputs>;
+
+  // trajectory holds steps * inputs values, step-major, e.g. from fourier_trajectory or recorded
+  // from a live run. results is resized to genomes.size()
+  void evaluate(std::span<const Network> genomes, std::span<int8_t const> trajectory,
+                std::vector<Evaluation> &results) {
+    const int size = static_cast<int>(genomes.size());
+    const int steps = static_cast<int>(trajectory.size() / inputs);
+    if (!population || population->size() != size) {
+      population = std::make_unique<SNNPopulation<inputs, hidden, outputs>>(size);
+    }
+    for (int n = 0; n < size; ++n) {
+      population->set_network(n, genomes[n]);
+    }
+    population->clear();
+
+    std::vector<std::uint32_t> spikes(size, 0);
+    results.assign(size, Evaluation{});
+    for (auto &result : results) {
+      result.steps = steps;
+      result.output_min.fill(std::numeric_limits<int16_t>::max());
+      result.output_max.fill(std::numeric_limits<int16_t>::min());
+    }
+
+    for (int step = 0; step < steps; ++step) {
+      population->update_shared(
+          trajectory.subspan(static_cast<std::size_t>(step) * inputs, inputs));
+      population->count_spikes(spikes);
+      population->get_output(output);
+#pragma omp parallel for schedule(static)
+      for (int n = 0; n < size; ++n) {
+        auto &result = results[n];
+        for (int j = 0; j < outputs; ++j) {
+          const int16_t v = output[n * outputs + j];
+          result.output_sum[j] += v;
+          result.output_sq_sum[j] += static_cast<std::int64_t>(v) * v;
+          result.output_min[j] = std::min(result.output_min[j], v);
+          result.output_max[j] = std::max(result.output_max[j], v);
+        }
+      }
+    }
+
+    for (int n = 0; n < size; ++n) {
+      results[n].spikes = spikes[n];
+    }
+    m_network_steps += static_cast<std::uint64_t>(size) * steps;
+  }
+
+  // network steps performed since construction, for throughput reporting
+  std::uint64_t network_steps() const {
+    return m_network_steps;
+  }
+
+private:
+  std::unique_ptr<SNNPopulation<inputs, hidden, outputs>> population;
+  std::vector<int16_t> output;
+  std::uint64_t m_network_steps = 0;
+};
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "snn.h"
+
+// Genetic operators on SNN weights. they work in place on preallocated records and draw every
+// random number from a counter-based generator, so each weight is an independent branch-free
+// computation and whole generations can be reproduced in parallel without locks or allocation.
+
+// the value for (stream, counter) is a hash of the two, so no generator state is carried between
+// draws. use one stream per genome and operation, and the weight index as the counter.
+struct CounterRNG {
+  uint64_t seed = 0;
+
+  uint64_t operator()(uint64_t stream, uint64_t counter) const {
+    // splitmix64 finalizer over a Weyl sequence
+    uint64_t z = seed + stream * 0xd1b54a32d192ed03ull + counter * 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+};
+
+namespace snn_genetics {
+
+// probability in [0, 1] as a threshold on 32 random bits
+inline uint32_t rate_threshold(float rate) {
+  return static_cast<uint32_t>(std::clamp(rate, 0.0f, 1.0f) * 4294967295.0f);
+}
+
+// add v to a gene, saturating to the gene's range instead of wrapping
+template <typename T> T saturate(int v) {
+  return static_cast<T>(
+      std::clamp<int>(v, std::numeric_limits<T>::min(), std::numeric_limits<T>::max()));
+}
+
+// with probability rate, adds approximately normal noise with standard deviation sigma to each
+// gene. the noise is the sum of four random bytes (Irwin-Hall), which needs no transcendentals.
+// genes whose mask byte is 0 are forced to 0; pass an empty mask to skip masking.
+template <typename T>
+void mutate_gaussian(std::span<T> genes, std::span<const uint8_t> mask, float sigma, float rate,
+                     CounterRNG rng, uint64_t stream) {
+  // standard deviation of the sum of four uniform bytes is sqrt(4 * (256^2 - 1) / 12)
+  constexpr float IRWIN_HALL_SD = 147.8f;
+  const auto threshold = rate_threshold(rate);
+  const auto scale = static_cast<int32_t>(sigma * 65536.0f / IRWIN_HALL_SD);
+  const bool masked = !mask.empty();
+  const int size = static_cast<int>(genes.size());
+  for (int k = 0; k < size; ++k) {
+    const uint64_t r = rng(stream, k);
+    const int noise = static_cast<int>((r >> 32) & 0xff) + static_cast<int>((r >> 40) & 0xff) +
+                      static_cast<int>((r >> 48) & 0xff) + static_cast<int>(r >> 56) - 510;
+    const int delta = static_cast<uint32_t>(r) < threshold ? (noise * scale + 32768) >> 16 : 0;
+    const T v = saturate<T>(genes[k] + delta);
+    genes[k] = masked && mask[k] == 0 ? T{0} : v;
+  }
+}
+
+// with probability rate, adds a uniform integer in [-range, range] to each gene
+template <typename T>
+void mutate_uniform(std::span<T> genes, std::span<const uint8_t> mask, int range, float rate,
+                    CounterRNG rng, uint64_t stream) {
+  const auto threshold = rate_threshold(rate);
+  const auto span = static_cast<uint64_t>(2 * range + 1);
+  const bool masked = !mask.empty();
+  const int size = static_cast<int>(genes.size());
+  for (int k = 0; k < size; ++k) {
+    const uint64_t r = rng(stream, k);
+    // multiply-shift maps the high 32 bits onto [0, span)
+    const int offset = static_cast<int>(((r >> 32) * span) >> 32) - range;
+    const int delta = static_cast<uint32_t>(r) < threshold ? offset : 0;
+    const T v = saturate<T>(genes[k] + delta);
+    genes[k] = masked && mask[k] == 0 ? T{0} : v;
+  }
+}
+
+// structural mutation: enabled connections are pruned with probability remove_rate, disabled ones
+// are re-enabled with probability add_rate. re-enabled weights start at 0.
+inline void mutate_structure(std::span<uint8_t> mask, float add_rate, float remove_rate,
+                             CounterRNG rng, uint64_t stream) {
+  const auto add = rate_threshold(add_rate);
+  const auto remove = rate_threshold(remove_rate);
+  const int size = static_cast<int>(mask.size());
+  for (int k = 0; k < size; ++k) {
+    const auto r = static_cast<uint32_t>(rng(stream, k));
+    mask[k] = mask[k] != 0 ? (r < remove ? 0 : 0xff) : (r < add ? 0xff : 0);
+  }
+}
+
+} // namespace snn_genetics
+
+struct MutationParams {
+  float weight_rate = 0.05f;  // chance that a weight gets noise
+  float weight_sigma = 8.0f;  // noise standard deviation, in int8 steps
+  float bias_rate = 0.05f;
+  float bias_sigma = 4.0f;
+  float add_rate = 0.0f;      // chance that a pruned connection comes back
+  float remove_rate = 0.0f;   // chance that a connection is pruned
+};
+
+// Preallocated pool of SNN<inputs, hidden, outputs> genomes, each one flat record of bytes:
+// w_hidden_input, w_hidden_hidden and w_output_hidden in SNN's layout, then b_hidden. every genome
+// also has a structural mask over its weights (0xff = connection present, 0 = pruned). records are
+// padded to 64 bytes so each starts on a cache line.
+template <int inputs, int hidden, int outputs> class SNNGenomePool {
+public:
+  using Network = SNN<inputs, hidden, outputs>;
+
+  static constexpr int WEIGHTS = hidden * (inputs + hidden + outputs);
+  static constexpr int RECORD = WEIGHTS + hidden;
+  static constexpr int STRIDE = (RECORD + 63) / 64 * 64;
+
+  explicit SNNGenomePool(int size)
+      : m_size(size), genes(static_cast<std::size_t>(size) * STRIDE, 0),
+        masks(static_cast<std::size_t>(size) * STRIDE, 0xff) {}
+
+  int size() const {
+    return m_size;
+  }
+
+  std::span<int8_t> weights(int g) {
+    return {reinterpret_cast<int8_t *>(&genes[offset(g)]), WEIGHTS};
+  }
+  std::span<const int8_t> weights(int g) const {
+    return {reinterpret_cast<const int8_t *>(&genes[offset(g)]), WEIGHTS};
+  }
+  std::span<uint8_t> bias(int g) {
+    return {&genes[offset(g) + WEIGHTS], hidden};
+  }
+  std::span<const uint8_t> bias(int g) const {
+    return {&genes[offset(g) + WEIGHTS], hidden};
+  }
+  std::span<uint8_t> mask(int g) {
+    return {&masks[offset(g)], WEIGHTS};
+  }
+  std::span<const uint8_t> mask(int g) const {
+    return {&masks[offset(g)], WEIGHTS};
+  }
+
+  // genome g as one record of RECORD bytes, e.g. for GenomeArchive. the mask is not included
+  std::span<const uint8_t> record(int g) const {
+    return {&genes[offset(g)], RECORD};
+  }
+  void set_record(int g, std::span<const uint8_t> record) {
+    std::copy_n(record.begin(), RECORD, &genes[offset(g)]);
+  }
+
+  // copy a network's weights into genome g. the mask is left as is
+  void load(int g, const Network &net) {
+    int8_t *w = weights(g).data();
+    w = std::copy(net.w_hidden_input.begin(), net.w_hidden_input.end(), w);
+    w = std::copy(net.w_hidden_hidden.begin(), net.w_hidden_hidden.end(), w);
+    std::copy(net.w_output_hidden.begin(), net.w_output_hidden.end(), w);
+    std::copy(net.b_hidden.begin(), net.b_hidden.end(), bias(g).begin());
+  }
+
+  // build a network from genome g, with cleared state
+  void store(int g, Network &net) const {
+    const int8_t *w = weights(g).data();
+    std::copy_n(w, hidden * inputs, net.w_hidden_input.begin());
+    w += hidden * inputs;
+    std::copy_n(w, hidden * hidden, net.w_hidden_hidden.begin());
+    w += hidden * hidden;
+    std::copy_n(w, hidden * outputs, net.w_output_hidden.begin());
+    std::copy_n(bias(g).begin(), hidden, net.b_hidden.begin());
+    net.clear();
+  }
+
+  // zero the weights of pruned connections
+  void apply_mask(int g) {
+    auto w = weights(g);
+    auto m = mask(g);
+    for (int k = 0; k < WEIGHTS; ++k) {
+      w[k] = m[k] != 0 ? w[k] : int8_t{0};
+    }
+  }
+
+  // genome g = genome src of another pool, weights and mask
+  void copy(int g, const SNNGenomePool &from, int src) {
+    std::memcpy(&genes[offset(g)], &from.genes[from.offset(src)], STRIDE);
+    std::memcpy(&masks[offset(g)], &from.masks[from.offset(src)], STRIDE);
+  }
+
+  // every weight and bias (with its mask byte) comes from parent a or b with equal chance
+  void crossover_uniform(int child, const SNNGenomePool &parents, int a, int b, CounterRNG rng,
+                         uint64_t stream) {
+    uint8_t *dst = &genes[offset(child)], *dst_mask = &masks[offset(child)];
+    const uint8_t *src_a = &parents.genes[parents.offset(a)];
+    const uint8_t *src_b = &parents.genes[parents.offset(b)];
+    const uint8_t *mask_a = &parents.masks[parents.offset(a)];
+    const uint8_t *mask_b = &parents.masks[parents.offset(b)];
+    // one draw picks the parent for 64 bytes
+    for (int word = 0; word < STRIDE / 64; ++word) {
+      const uint64_t pick = rng(stream, word);
+      for (int k = word * 64; k < word * 64 + 64; ++k) {
+        const bool from_b = (pick >> (k % 64)) & 1;
+        dst[k] = from_b ? src_b[k] : src_a[k];
+        dst_mask[k] = from_b ? mask_b[k] : mask_a[k];
+      }
+    }
+  }
+
+  // block crossover with one block per hidden neuron: its input weights, outgoing recurrent and
+  // output weights and bias are inherited together from parent a or b, so neurons keep working
+  // as a unit. incoming recurrent weights come with the presynaptic neuron.
+  void crossover_neurons(int child, const SNNGenomePool &parents, int a, int b, CounterRNG rng,
+                         uint64_t stream) {
+    for (int i = 0; i < hidden; ++i) {
+      const bool from_b = (rng(stream, i / 64) >> (i % 64)) & 1;
+      const std::size_t src = parents.offset(from_b ? b : a), dst = offset(child);
+      // input row, outgoing recurrent row, output row, bias
+      const std::pair<int, int> blocks[] = {{i * inputs, inputs},
+                                            {hidden * inputs + i * hidden, hidden},
+                                            {hidden * (inputs + hidden) + i * outputs, outputs},
+                                            {WEIGHTS + i, 1}};
+      for (const auto &[start, length] : blocks) {
+        std::memcpy(&genes[dst + start], &parents.genes[src + start], length);
+        std::memcpy(&masks[dst + start], &parents.masks[src + start], length);
+      }
+    }
+  }
+
+  // structural mutation, then Gaussian noise on the weights that are still connected and on the
+  // biases. stream must differ per genome and generation
+  void mutate(int g, const MutationParams &params, CounterRNG rng, uint64_t stream) {
+    if (params.add_rate > 0.0f || params.remove_rate > 0.0f) {
+      snn_genetics::mutate_structure(mask(g), params.add_rate, params.remove_rate, rng,
+                                     stream * 3);
+    }
+    snn_genetics::mutate_gaussian(weights(g), std::span<const uint8_t>(mask(g)),
+                                  params.weight_sigma, params.weight_rate, rng, stream * 3 + 1);
+    snn_genetics::mutate_gaussian(bias(g), {}, params.bias_sigma, params.bias_rate, rng,
+                                  stream * 3 + 2);
+  }
+
+private:
+  int m_size;
+  std::vector<uint8_t> genes; // [genome][STRIDE], weights then biases
+  std::vector<uint8_t> masks; // [genome][STRIDE], only the first WEIGHTS bytes are used
+
+  std::size_t offset(int g) const {
+    return static_cast<std::size_t>(g) * STRIDE;
+  }
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <omp.h>
+
+#include "snn.h"
+
+// Steps one large SNN on a team of OpenMP threads for many ticks. the hidden layer is split into
+// ranges of whole 64-neuron words, one per thread, so each thread writes only its own words of the
+// spike bitmap and its own cache lines of state. every tick, each thread integrates its neurons'
+// inputs, adds the slices of the recurrent columns of last tick's spikes (read from the shared
+// bitmap) and fires; a barrier then publishes the new bitmap. the team lives for the whole run,
+// so a tick costs two barriers rather than a fork and join.
+// input(step) gives the inputs of a step and on_step(step) runs after it, both on one thread with
+// the network quiescent, so on_step may read outputs or spikes. threads = 0 uses the OpenMP
+// default. steps exactly like calling SNN::update once per step.
+template <int inputs, int hidden, int outputs, typename Input, typename OnStep>
+void update_partitioned(SNN<inputs, hidden, outputs> &net, int steps, Input &&input,
+                        OnStep &&on_step, int threads = 0) {
+  constexpr int WORDS = spike_words(hidden);
+  constexpr int CHUNK = 64;
+  array<uint64_t, WORDS> next{};
+  std::span<int8_t const> current;
+  if (threads <= 0)
+    threads = omp_get_max_threads();
+
+#pragma omp parallel num_threads(threads)
+  {
+    const int team = omp_get_num_threads();
+    const int t = omp_get_thread_num();
+    const int begin = std::min(WORDS * t / team * CHUNK, hidden);
+    const int end = std::min(WORDS * (t + 1) / team * CHUNK, hidden);
+    const int count = end - begin;
+    std::vector<int16_t> acc(count);
+    array<uint16_t, hidden> spikes;
+
+#pragma omp single
+    current = input(0);
+
+    for (int step = 0; step < steps; ++step) {
+      if (count > 0) {
+        int16_t *a = acc.data();
+        snn_kernels::integrate_state(count, &net.s_hidden[begin], &net.b_hidden[begin], a);
+        // whole words go through the SIMD projection, the tail of the last range is scalar
+        const int8_t *w_in = &net.w_hidden_input[begin * inputs];
+        int c = 0;
+        for (; c + CHUNK <= count; c += CHUNK)
+          snn_simd::project_inputs<inputs, CHUNK>(&w_in[c * inputs], current.data(), &a[c]);
+        snn_simd::project_inputs_scalar(inputs, count - c, &w_in[c * inputs], current.data(),
+                                        &a[c]);
+
+        const int spike_count =
+            snn_kernels::collect_spikes(hidden, net.act_hidden.data(), spikes.data());
+        for (int s = 0; s < spike_count; ++s) {
+          const int8_t *column = &net.w_hidden_hidden[spikes[s] * hidden + begin];
+#pragma omp simd
+          for (int i = 0; i < count; ++i)
+            a[i] = static_cast<int16_t>(a[i] + column[i]);
+        }
+        snn_kernels::fire(count, a, &net.s_hidden[begin], &next[begin / 64]);
+      }
+
+#pragma omp barrier
+#pragma omp single
+      {
+        net.act_hidden = next;
+        on_step(step);
+        if (step + 1 < steps)
+          current = input(step + 1);
+      }
+    }
+  }
+}
@@ -0,0 +1,281 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "snn.h"
+
+// Structure-of-arrays engine for many SNN<inputs, hidden, outputs> networks with the same topology.
+// Networks are grouped into blocks of `lanes`; within a block every weight, bias, state and
+// activation is stored interleaved across the block's networks ([block][element][lane]), so the
+// inner loops run SIMD lanes across networks and OpenMP threads across blocks.
+// Stepping is bit-identical to calling SNN::update on every network.
+// A block whose last step changed neither state nor activations has reached a fixed point, and
+// while its inputs stay the same every further step would too, so update skips it until one of
+// its networks' inputs changes (or set_network/clear touches it). the check is an exact compare of
+// the block's inputs against the ones it last ran with, so the saving scales with how many blocks
+// sit still.
+template <int inputs, int hidden, int outputs, int lanes = 32> class SNNPopulation {
+public:
+  using Network = SNN<inputs, hidden, outputs>;
+
+  explicit SNNPopulation(int size)
+      : m_size(size), m_blocks((size + lanes - 1) / lanes),
+        w_hidden_input(m_blocks * hidden * inputs * lanes, 0),
+        w_hidden_hidden(m_blocks * hidden * hidden * lanes, 0),
+        w_output_hidden(m_blocks * outputs * hidden * lanes, 0),
+        b_hidden(m_blocks * hidden * lanes, 0), s_hidden(m_blocks * hidden * lanes, 0),
+        act_hidden(m_blocks * hidden * lanes, 0), last_input(m_blocks * inputs * lanes, 0),
+        quiescent(m_blocks, 0) {}
+
+  int size() const {
+    return m_size;
+  }
+
+  // copy a network's weights and state into slot n
+  void set_network(int n, const Network &net) {
+    const int block = n / lanes, lane = n % lanes;
+    for (int k = 0; k < hidden * inputs; ++k)
+      w_hidden_input[index(block, k, hidden * inputs, lane)] = net.w_hidden_input[k];
+    // the population keeps recurrent and output weights per postsynaptic neuron, so every lane
+    // of a row reads the same neuron's inputs
+    for (int i = 0; i < hidden; ++i)
+      for (int j = 0; j < hidden; ++j)
+        w_hidden_hidden[index(block, i * hidden + j, hidden * hidden, lane)] =
+            net.w_hidden_hidden[j * hidden + i];
+    for (int j = 0; j < outputs; ++j)
+      for (int i = 0; i < hidden; ++i)
+        w_output_hidden[index(block, j * hidden + i, outputs * hidden, lane)] =
+            net.w_output_hidden[i * outputs + j];
+    for (int i = 0; i < hidden; ++i) {
+      b_hidden[index(block, i, hidden, lane)] = net.b_hidden[i];
+      s_hidden[index(block, i, hidden, lane)] = net.s_hidden[i];
+      act_hidden[index(block, i, hidden, lane)] = net.spiked(i);
+    }
+    quiescent[block] = 0;
+  }
+
+  // copy slot n back out into a standalone network
+  void get_network(int n, Network &net) const {
+    const int block = n / lanes, lane = n % lanes;
+    for (int k = 0; k < hidden * inputs; ++k)
+      net.w_hidden_input[k] = w_hidden_input[index(block, k, hidden * inputs, lane)];
+    for (int i = 0; i < hidden; ++i)
+      for (int j = 0; j < hidden; ++j)
+        net.w_hidden_hidden[j * hidden + i] =
+            w_hidden_hidden[index(block, i * hidden + j, hidden * hidden, lane)];
+    for (int j = 0; j < outputs; ++j)
+      for (int i = 0; i < hidden; ++i)
+        net.w_output_hidden[i * outputs + j] =
+            w_output_hidden[index(block, j * hidden + i, outputs * hidden, lane)];
+    std::fill(net.act_hidden.begin(), net.act_hidden.end(), 0);
+    for (int i = 0; i < hidden; ++i) {
+      net.b_hidden[i] = b_hidden[index(block, i, hidden, lane)];
+      net.s_hidden[i] = s_hidden[index(block, i, hidden, lane)];
+      if (act_hidden[index(block, i, hidden, lane)]) {
+        net.act_hidden[i / 64] |= uint64_t{1} << (i % 64);
+      }
+    }
+  }
+
+  // quiescent blocks are skipped by default. with skipping off every block is stepped and its
+  // inputs are not compared, e.g. to measure what the check costs a fully active population
+  void set_skip_quiescent(bool skip) {
+    m_skip_quiescent = skip;
+    // last_input isn't kept up to date while skipping is off
+    std::fill(quiescent.begin(), quiescent.end(), 0);
+  }
+
+  void clear() {
+    std::fill(s_hidden.begin(), s_hidden.end(), 0);
+    std::fill(act_hidden.begin(), act_hidden.end(), 0);
+    std::fill(quiescent.begin(), quiescent.end(), 0);
+  }
+
+  // input holds size() * inputs values, network-major (input[n * inputs + j])
+  void update(std::span<int8_t const> input) {
+    update(input, inputs);
+  }
+
+  // every network reads the same input values
+  void update_shared(std::span<int8_t const> input) {
+    update(input, 0);
+  }
+
+  // output is resized to size() * outputs, network-major (output[n * outputs + j])
+  void get_output(std::vector<int16_t> &output) const {
+    output.resize(m_size * outputs);
+#pragma omp parallel for schedule(static)
+    for (int block = 0; block < m_blocks; ++block) {
+      const int8_t *w = &w_output_hidden[block * outputs * hidden * lanes];
+      const uint8_t *act = &act_hidden[block * hidden * lanes];
+      for (int j = 0; j < outputs; ++j) {
+        int16_t acc[lanes] = {};
+        for (int i = 0; i < hidden; ++i) {
+          const int8_t *w_row = w + (j * hidden + i) * lanes;
+          const uint8_t *act_row = act + i * lanes;
+#pragma omp simd
+          for (int l = 0; l < lanes; ++l) {
+            acc[l] = static_cast<int16_t>(acc[l] + w_row[l] * act_row[l]);
+          }
+        }
+        for (int l = 0; l < lanes && block * lanes + l < m_size; ++l) {
+          output[(block * lanes + l) * outputs + j] = acc[l];
+        }
+      }
+    }
+  }
+
+  // adds the number of hidden neurons of network n that spiked last step to counts[n]
+  void count_spikes(std::span<std::uint32_t> counts) const {
+#pragma omp parallel for schedule(static)
+    for (int block = 0; block < m_blocks; ++block) {
+      const uint8_t *act = &act_hidden[block * hidden * lanes];
+      std::uint32_t count[lanes] = {};
+      for (int i = 0; i < hidden; ++i) {
+#pragma omp simd
+        for (int l = 0; l < lanes; ++l) {
+          count[l] += act[i * lanes + l];
+        }
+      }
+      for (int l = 0; l < lanes && block * lanes + l < m_size; ++l) {
+        counts[block * lanes + l] += count[l];
+      }
+    }
+  }
+
+  bool spiked(int n, int i) const {
+    return act_hidden[index(n / lanes, i, hidden, n % lanes)] != 0;
+  }
+
+  uint8_t state(int n, int i) const {
+    return s_hidden[index(n / lanes, i, hidden, n % lanes)];
+  }
+
+  // hidden neuron updates performed since construction, for throughput reporting
+  std::uint64_t neuron_updates() const {
+    return m_neuron_updates;
+  }
+  // hidden neuron updates skipped because their block was quiescent
+  std::uint64_t skipped_updates() const {
+    return m_skipped_updates;
+  }
+  // blocks that skipped their last step
+  int quiescent_blocks() const {
+    return static_cast<int>(std::count(quiescent.begin(), quiescent.end(), 2));
+  }
+
+private:
+  int m_size, m_blocks;
+  bool m_skip_quiescent = true;
+  std::uint64_t m_neuron_updates = 0;
+  std::uint64_t m_skipped_updates = 0;
+
+  // all arrays are [block][element][lane]
+  std::vector<int8_t> w_hidden_input;
+  std::vector<int8_t> w_hidden_hidden;
+  std::vector<int8_t> w_output_hidden;
+  std::vector<uint8_t> b_hidden;
+  std::vector<uint8_t> s_hidden;
+  std::vector<uint8_t> act_hidden; // 0 or 1, so it can be multiplied in instead of branched on
+  std::vector<int8_t> last_input;  // [block][input][lane], what each block last ran with
+  // per block: 0 = active, 1 = reached a fixed point last step, 2 = skipped last step
+  std::vector<uint8_t> quiescent;
+
+  // network n's inputs start at input[n * stride]
+  void update(std::span<int8_t const> input, int stride) {
+    std::uint64_t computed = 0;
+#pragma omp parallel for schedule(static) reduction(+ : computed)
+    for (int block = 0; block < m_blocks; ++block) {
+      if (update_block(block, input, stride))
+        computed += std::min(lanes, m_size - block * lanes);
+    }
+    m_neuron_updates += computed * hidden;
+    m_skipped_updates += (m_size - computed) * hidden;
+  }
+
+  static std::size_t index(int block, int element, int elements, int lane) {
+    return (static_cast<std::size_t>(block) * elements + element) * lanes + lane;
+  }
+
+  // same arithmetic as SNN::update, one network per lane. the int16 accumulator wraps exactly like
+  // the scalar version's int16_t acc. returns false if the block was quiescent and skipped
+  bool update_block(int block, std::span<int8_t const> input, int stride) {
+    static constexpr uint8_t LEAK_SHIFT = 4; // leak rate
+    static constexpr int THRESHOLD = std::numeric_limits<uint8_t>::max();
+
+    // transpose this block's inputs to [j][lane]; missing networks in the last block read zeros
+    int8_t in[inputs][lanes];
+    for (int j = 0; j < inputs; ++j) {
+      for (int l = 0; l < lanes; ++l) {
+        const int n = block * lanes + l;
+        in[j][l] = n < m_size ? input[n * stride + j] : 0;
+      }
+    }
+    if (m_skip_quiescent) {
+      int8_t *last = &last_input[block * inputs * lanes];
+      const bool same_input = std::equal(&in[0][0], &in[0][0] + inputs * lanes, last);
+      if (quiescent[block] != 0 && same_input) {
+        quiescent[block] = 2;
+        return false;
+      }
+      if (!same_input)
+        std::copy(&in[0][0], &in[0][0] + inputs * lanes, last);
+    }
+
+    const int8_t *w_in = &w_hidden_input[block * hidden * inputs * lanes];
+    const int8_t *w_rec = &w_hidden_hidden[block * hidden * hidden * lanes];
+    const uint8_t *bias = &b_hidden[block * hidden * lanes];
+    uint8_t *state = &s_hidden[block * hidden * lanes];
+    uint8_t *act = &act_hidden[block * hidden * lanes];
+    uint8_t act_next[hidden][lanes];
+    uint8_t changed = 0;
+
+    for (int i = 0; i < hidden; ++i) {
+      int16_t acc[lanes];
+#pragma omp simd
+      for (int l = 0; l < lanes; ++l) {
+        // start with current accumulated hidden state, apply leak, add bias
+        int16_t a = state[i * lanes + l];
+        a = static_cast<int16_t>(a - (static_cast<uint8_t>(a) >> LEAK_SHIFT));
+        acc[l] = static_cast<int16_t>(a + bias[i * lanes + l]);
+      }
+
+      // add inputs
+      for (int j = 0; j < inputs; ++j) {
+        const int8_t *w_row = w_in + (i * inputs + j) * lanes;
+#pragma omp simd
+        for (int l = 0; l < lanes; ++l) {
+          acc[l] = static_cast<int16_t>(
+              acc[l] + (static_cast<int16_t>(w_row[l]) * static_cast<int16_t>(in[j][l]) >> 8));
+        }
+      }
+
+      // add recurrent connections
+      for (int j = 0; j < hidden; ++j) {
+        const int8_t *w_row = w_rec + (i * hidden + j) * lanes;
+        const uint8_t *act_row = act + j * lanes;
+#pragma omp simd
+        for (int l = 0; l < lanes; ++l) {
+          acc[l] = static_cast<int16_t>(acc[l] + w_row[l] * act_row[l]);
+        }
+      }
+
+      // spike and reset
+#pragma omp simd reduction(| : changed)
+      for (int l = 0; l < lanes; ++l) {
+        const bool fired = acc[l] >= THRESHOLD;
+        const uint8_t next = (fired || acc[l] < 0) ? 0 : static_cast<uint8_t>(acc[l]);
+        changed |= (state[i * lanes + l] ^ next) | (act[i * lanes + l] ^ fired);
+        act_next[i][l] = fired;
+        state[i * lanes + l] = next;
+      }
+    }
+
+    std::copy(&act_next[0][0], &act_next[0][0] + hidden * lanes, act);
+    quiescent[block] = changed == 0;
+    return true;
+  }
+};
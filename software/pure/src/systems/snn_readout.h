@@ -0,0 +1,104 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <span>
+
+#include "snn.h"
+
+struct ReadoutReport {
+  uint64_t samples = 0;
+  double rmse = 0.0;           // output error of the float solution
+  double quantized_rmse = 0.0; // output error after rounding to int8
+  double weight_error = 0.0;   // rms difference between the float and int8 weights
+  int clipped = 0;             // weights outside the int8 range, clamped
+};
+
+// Closed-form training of SNN::w_output_hidden. get_output is the sum of the output weights of the
+// neurons that spiked, so with the spikes of step t as row t of a 0/1 matrix X and the wanted
+// outputs as row t of Y, the best readout is the ridge regression
+//   W = (X^T X + ridge I)^-1 X^T Y
+// X itself is never stored: record() adds each step to the Gram matrix X^T X and to X^T Y, which
+// costs O(spikes^2 + spikes * outputs) per step and O(hidden^2) memory however long the run is,
+// and the same sums give the exact training error of any W. there is no intercept, since
+// get_output has none.
+template <int inputs, int hidden, int outputs> class SNNReadoutTrainer {
+public:
+  using Network = SNN<inputs, hidden, outputs>;
+
+  SNNReadoutTrainer() : gram(hidden, hidden), cross(hidden, outputs), target_sq(outputs) {
+    clear();
+  }
+
+  void clear() {
+    gram.setZero();
+    cross.setZero();
+    target_sq.setZero();
+    m_samples = 0;
+  }
+
+  // one step: call after net.update, with the outputs get_output should have given for it
+  void record(const Network &net, std::span<const float> target) {
+    array<uint16_t, hidden> spikes;
+    const int spike_count = net.collect_spikes(spikes);
+    for (int a = 0; a < spike_count; ++a) {
+      for (int b = 0; b < spike_count; ++b)
+        gram(spikes[a], spikes[b]) += 1.0;
+      for (int j = 0; j < outputs; ++j)
+        cross(spikes[a], j) += target[j];
+    }
+    for (int j = 0; j < outputs; ++j)
+      target_sq[j] += static_cast<double>(target[j]) * target[j];
+    ++m_samples;
+  }
+
+  uint64_t samples() const {
+    return m_samples;
+  }
+
+  // solves for the readout, rounds it into net.w_output_hidden and reports the errors. ridge is
+  // in units of spikes; neurons that never spiked get weight 0
+  ReadoutReport solve(double ridge, Network &net) const {
+    ReadoutReport report;
+    report.samples = m_samples;
+    if (m_samples == 0)
+      return report;
+    const Eigen::MatrixXd regularized = gram + ridge * Eigen::MatrixXd::Identity(hidden, hidden);
+    const Eigen::MatrixXd w = regularized.ldlt().solve(cross);
+
+    Eigen::MatrixXd quantized(hidden, outputs);
+    double weight_sq = 0.0;
+    for (int i = 0; i < hidden; ++i) {
+      for (int j = 0; j < outputs; ++j) {
+        const double rounded = std::round(w(i, j));
+        const double clamped = std::clamp(rounded, -128.0, 127.0);
+        report.clipped += rounded != clamped;
+        quantized(i, j) = clamped;
+        net.w_output_hidden[i * outputs + j] = static_cast<int8_t>(clamped);
+        weight_sq += (w(i, j) - clamped) * (w(i, j) - clamped);
+      }
+    }
+    report.weight_error = std::sqrt(weight_sq / (hidden * outputs));
+    report.rmse = rmse(w);
+    report.quantized_rmse = rmse(quantized);
+    return report;
+  }
+
+  // rms output error of a readout over the recorded steps,
+  // sum_t |x_t W - y_t|^2 = tr(W^T X^T X W) - 2 tr(W^T X^T Y) + sum |y_t|^2
+  double rmse(const Eigen::MatrixXd &w) const {
+    const double error = (w.transpose() * gram * w).trace() -
+                         2.0 * (w.transpose() * cross).trace() + target_sq.sum();
+    return std::sqrt(std::max(error, 0.0) / (static_cast<double>(m_samples) * outputs));
+  }
+
+private:
+  // dynamic sizes, since hidden^2 doubles are past Eigen's fixed-size stack limit
+  Eigen::MatrixXd gram;      // X^T X, spike co-occurrence counts
+  Eigen::MatrixXd cross;     // X^T Y
+  Eigen::VectorXd target_sq; // sum of y^2 per output
+  uint64_t m_samples = 0;
+};
@@ -0,0 +1,449 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SNN_SIMD_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define SNN_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+// GCC and Clang compile each x86 kernel for its own ISA, whatever the target flags, and the CPU
+// picks one at runtime. MSVC has no per-function targets, so there a kernel only runs when the
+// target flags guarantee its ISA (/arch:AVX2 defines __AVX2__ but never __SSE4_1__)
+#if defined(SNN_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define SNN_SIMD_TARGET(isa) __attribute__((target(isa)))
+#define SNN_SIMD_RUNTIME
+#else
+#define SNN_SIMD_TARGET(isa)
+#endif
+
+// Vectorized kernels for SNN. every kernel keeps the scalar arithmetic exactly (each int8 * int8
+// product is shifted right by 8 on its own, sums wrap in int16), so results are bit-identical to
+// the scalar fallback on every ISA.
+namespace snn_simd {
+
+enum class Isa { scalar, sse41, avx2, neon };
+
+inline const char *name(Isa isa) {
+  switch (isa) {
+  case Isa::sse41:
+    return "sse4.1";
+  case Isa::avx2:
+    return "avx2";
+  case Isa::neon:
+    return "neon";
+  default:
+    return "scalar";
+  }
+}
+
+// the best ISA this CPU runs the kernels on
+inline Isa detect() {
+#if defined(SNN_SIMD_RUNTIME)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return Isa::avx2;
+  if (__builtin_cpu_supports("sse4.1"))
+    return Isa::sse41;
+  return Isa::scalar;
+#elif defined(__AVX2__)
+  return Isa::avx2;
+#elif defined(__SSE4_1__)
+  return Isa::sse41;
+#elif defined(SNN_SIMD_NEON)
+  return Isa::neon;
+#else
+  return Isa::scalar;
+#endif
+}
+
+// the ISA the kernels use. starts at the best one; use() lowers it
+inline Isa active = detect();
+
+// switches the kernels to isa, for checking or timing it against the others. false if this CPU
+// can't run it. not thread safe, call while no kernel runs
+inline bool use(Isa isa) {
+  const Isa best = detect();
+  const bool x86 = best == Isa::sse41 || best == Isa::avx2;
+  if (isa != Isa::scalar && isa != best && !(x86 && isa == Isa::sse41))
+    return false;
+  active = isa;
+  return true;
+}
+
+// acc[i] += sum_j (w[i * inputs + j] * input[j]) >> 8, for every hidden neuron i. also the generic
+// kernel for sizes only known at runtime
+inline void project_inputs_scalar(int inputs, int hidden, const int8_t *w, const int8_t *input,
+                                  int16_t *acc) {
+  for (auto i = 0; i < hidden; ++i) {
+    int16_t a = acc[i];
+    for (auto j = 0; j < inputs; ++j) {
+      a += (static_cast<int16_t>(w[i * inputs + j]) * static_cast<int16_t>(input[j]) >> 8);
+    }
+    acc[i] = a;
+  }
+}
+
+#if defined(SNN_SIMD_X86)
+template <int inputs, int hidden>
+SNN_SIMD_TARGET("avx2") void project_inputs_avx2(const int8_t *w, const int8_t *input,
+                                                 int16_t *acc) {
+  constexpr int LANES = 16;
+  constexpr int CHUNKS = inputs / LANES;
+  constexpr int TAIL = CHUNKS * LANES;
+  if constexpr (CHUNKS == 0) {
+    project_inputs_scalar(inputs, hidden, w, input, acc);
+  } else {
+    // widen the inputs once, every row reuses them
+    __m256i in[CHUNKS];
+    for (auto c = 0; c < CHUNKS; ++c) {
+      in[c] = _mm256_cvtepi8_epi16(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + c * LANES)));
+    }
+    for (auto i = 0; i < hidden; ++i) {
+      const int8_t *row = w + i * inputs;
+      __m256i sum = _mm256_setzero_si256();
+      for (auto c = 0; c < CHUNKS; ++c) {
+        const __m256i wide = _mm256_cvtepi8_epi16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + c * LANES)));
+        sum = _mm256_add_epi16(sum, _mm256_srai_epi16(_mm256_mullo_epi16(wide, in[c]), 8));
+      }
+      __m128i half = _mm_add_epi16(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+      half = _mm_add_epi16(half, _mm_srli_si128(half, 8));
+      half = _mm_add_epi16(half, _mm_srli_si128(half, 4));
+      half = _mm_add_epi16(half, _mm_srli_si128(half, 2));
+      int16_t a = static_cast<int16_t>(acc[i] + static_cast<int16_t>(_mm_extract_epi16(half, 0)));
+      for (auto j = TAIL; j < inputs; ++j) {
+        a += (static_cast<int16_t>(row[j]) * static_cast<int16_t>(input[j]) >> 8);
+      }
+      acc[i] = a;
+    }
+  }
+}
+
+template <int inputs, int hidden>
+SNN_SIMD_TARGET("sse4.1") void project_inputs_sse41(const int8_t *w, const int8_t *input,
+                                                    int16_t *acc) {
+  constexpr int LANES = 8;
+  constexpr int CHUNKS = inputs / LANES;
+  constexpr int TAIL = CHUNKS * LANES;
+  if constexpr (CHUNKS == 0) {
+    project_inputs_scalar(inputs, hidden, w, input, acc);
+  } else {
+    __m128i in[CHUNKS];
+    for (auto c = 0; c < CHUNKS; ++c) {
+      in[c] = _mm_cvtepi8_epi16(
+          _mm_loadl_epi64(reinterpret_cast<const __m128i *>(input + c * LANES)));
+    }
+    for (auto i = 0; i < hidden; ++i) {
+      const int8_t *row = w + i * inputs;
+      __m128i sum = _mm_setzero_si128();
+      for (auto c = 0; c < CHUNKS; ++c) {
+        const __m128i wide =
+            _mm_cvtepi8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(row + c * LANES)));
+        sum = _mm_add_epi16(sum, _mm_srai_epi16(_mm_mullo_epi16(wide, in[c]), 8));
+      }
+      sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+      sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 4));
+      sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 2));
+      int16_t a = static_cast<int16_t>(acc[i] + static_cast<int16_t>(_mm_extract_epi16(sum, 0)));
+      for (auto j = TAIL; j < inputs; ++j) {
+        a += (static_cast<int16_t>(row[j]) * static_cast<int16_t>(input[j]) >> 8);
+      }
+      acc[i] = a;
+    }
+  }
+}
+#elif defined(SNN_SIMD_NEON)
+template <int inputs, int hidden>
+void project_inputs_neon(const int8_t *w, const int8_t *input, int16_t *acc) {
+  constexpr int LANES = 8;
+  constexpr int CHUNKS = inputs / LANES;
+  constexpr int TAIL = CHUNKS * LANES;
+  if constexpr (CHUNKS == 0) {
+    project_inputs_scalar(inputs, hidden, w, input, acc);
+  } else {
+    int16x8_t in[CHUNKS];
+    for (auto c = 0; c < CHUNKS; ++c) {
+      in[c] = vmovl_s8(vld1_s8(input + c * LANES));
+    }
+    for (auto i = 0; i < hidden; ++i) {
+      const int8_t *row = w + i * inputs;
+      int16x8_t sum = vdupq_n_s16(0);
+      for (auto c = 0; c < CHUNKS; ++c) {
+        const int16x8_t wide = vmovl_s8(vld1_s8(row + c * LANES));
+        sum = vaddq_s16(sum, vshrq_n_s16(vmulq_s16(wide, in[c]), 8));
+      }
+      int16_t a = static_cast<int16_t>(acc[i] + vaddvq_s16(sum));
+      for (auto j = TAIL; j < inputs; ++j) {
+        a += (static_cast<int16_t>(row[j]) * static_cast<int16_t>(input[j]) >> 8);
+      }
+      acc[i] = a;
+    }
+  }
+}
+#endif
+
+template <int inputs, int hidden>
+void project_inputs(const int8_t *w, const int8_t *input, int16_t *acc) {
+  switch (active) {
+#if defined(SNN_SIMD_X86)
+  case Isa::avx2:
+    project_inputs_avx2<inputs, hidden>(w, input, acc);
+    return;
+  case Isa::sse41:
+    project_inputs_sse41<inputs, hidden>(w, input, acc);
+    return;
+#elif defined(SNN_SIMD_NEON)
+  case Isa::neon:
+    project_inputs_neon<inputs, hidden>(w, input, acc);
+    return;
+#endif
+  default:
+    project_inputs_scalar(inputs, hidden, w, input, acc);
+  }
+}
+
+// Packed int4 weights: two per byte, element 2m in the low nibble of byte m and 2m + 1 in the high
+// nibble, each row starting on a byte. an int4 weight w stands for the int8 weight w << INT4_SHIFT,
+// and every kernel below is bit-identical to its int8 counterpart run on those int8 weights.
+constexpr int INT4_SHIFT = 4;
+
+constexpr int int4_stride(int columns) {
+  return (columns + 1) / 2;
+}
+
+inline int int4_at(const uint8_t *row, int j) {
+  const int nibble = (row[j / 2] >> (4 * (j % 2))) & 0xf;
+  return (nibble ^ 8) - 8;
+}
+
+// project_inputs with packed weights. (w << 4) * x >> 8 is the same as w * x >> 4
+inline void project_inputs_int4_scalar(int inputs, int hidden, const uint8_t *w,
+                                       const int8_t *input, int16_t *acc) {
+  for (auto i = 0; i < hidden; ++i) {
+    const uint8_t *row = w + i * int4_stride(inputs);
+    int16_t a = acc[i];
+    auto j = 0;
+    for (; j + 2 <= inputs; j += 2) {
+      const uint8_t b = row[j / 2];
+      a += ((((b & 0xf) ^ 8) - 8) * static_cast<int16_t>(input[j]) >> (8 - INT4_SHIFT));
+      a += (((b >> 4 ^ 8) - 8) * static_cast<int16_t>(input[j + 1]) >> (8 - INT4_SHIFT));
+    }
+    if (j < inputs) {
+      a += (int4_at(row, j) * static_cast<int16_t>(input[j]) >> (8 - INT4_SHIFT));
+    }
+    acc[i] = a;
+  }
+}
+
+// splits the inputs into the ones paired with low nibbles (even) and high nibbles (odd), for the
+// first chunks * bytes packed weights of each row
+template <int chunks, int bytes>
+void split_int4(const int8_t *input, int16_t (&even)[chunks][bytes],
+                int16_t (&odd)[chunks][bytes]) {
+  for (auto c = 0; c < chunks; ++c) {
+    for (auto m = 0; m < bytes; ++m) {
+      even[c][m] = input[(c * bytes + m) * 2];
+      odd[c][m] = input[(c * bytes + m) * 2 + 1];
+    }
+  }
+}
+
+// acc[k] += w[k] << INT4_SHIFT for the first length weights of one packed row, from k on. the
+// scalar tail of accumulate_int4
+inline void accumulate_int4_scalar(int k, int length, const uint8_t *row, int16_t *acc) {
+  // whole bytes, then a final low nibble if length is odd
+  for (; k + 2 <= length; k += 2) {
+    const uint8_t b = row[k / 2];
+    acc[k] = static_cast<int16_t>(acc[k] + ((((b & 0xf) ^ 8) - 8) << INT4_SHIFT));
+    acc[k + 1] = static_cast<int16_t>(acc[k + 1] + (((b >> 4 ^ 8) - 8) << INT4_SHIFT));
+  }
+  if (k < length) {
+    acc[k] = static_cast<int16_t>(acc[k] + (int4_at(row, k) << INT4_SHIFT));
+  }
+}
+
+#if defined(SNN_SIMD_X86)
+template <int inputs, int hidden>
+SNN_SIMD_TARGET("avx2") void project_inputs_int4_avx2(const uint8_t *w, const int8_t *input,
+                                                      int16_t *acc) {
+  // bytes per vector chunk, each holding two weights
+  constexpr int BYTES = 16;
+  constexpr int STRIDE = int4_stride(inputs);
+  constexpr int CHUNKS = inputs / 2 / BYTES;
+  constexpr int TAIL = CHUNKS * BYTES * 2;
+  if constexpr (CHUNKS == 0) {
+    project_inputs_int4_scalar(inputs, hidden, w, input, acc);
+  } else {
+    alignas(32) int16_t even[CHUNKS][BYTES], odd[CHUNKS][BYTES];
+    split_int4(input, even, odd);
+    for (auto i = 0; i < hidden; ++i) {
+      const uint8_t *row = w + i * STRIDE;
+      __m256i sum = _mm256_setzero_si256();
+      for (auto c = 0; c < CHUNKS; ++c) {
+        const __m256i bytes = _mm256_cvtepu8_epi16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + c * BYTES)));
+        // sign-extend each nibble by shifting it to the top of the 16 bit lane and back
+        const __m256i lo = _mm256_srai_epi16(_mm256_slli_epi16(bytes, 12), 12);
+        const __m256i hi = _mm256_srai_epi16(_mm256_slli_epi16(bytes, 8), 12);
+        const __m256i e = _mm256_load_si256(reinterpret_cast<const __m256i *>(even[c]));
+        const __m256i o = _mm256_load_si256(reinterpret_cast<const __m256i *>(odd[c]));
+        sum = _mm256_add_epi16(sum, _mm256_srai_epi16(_mm256_mullo_epi16(lo, e), 8 - INT4_SHIFT));
+        sum = _mm256_add_epi16(sum, _mm256_srai_epi16(_mm256_mullo_epi16(hi, o), 8 - INT4_SHIFT));
+      }
+      __m128i half = _mm_add_epi16(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+      half = _mm_add_epi16(half, _mm_srli_si128(half, 8));
+      half = _mm_add_epi16(half, _mm_srli_si128(half, 4));
+      half = _mm_add_epi16(half, _mm_srli_si128(half, 2));
+      int16_t a = static_cast<int16_t>(acc[i] + static_cast<int16_t>(_mm_extract_epi16(half, 0)));
+      for (auto j = TAIL; j < inputs; ++j) {
+        a += (int4_at(row, j) * static_cast<int16_t>(input[j]) >> (8 - INT4_SHIFT));
+      }
+      acc[i] = a;
+    }
+  }
+}
+
+template <int inputs, int hidden>
+SNN_SIMD_TARGET("sse4.1") void project_inputs_int4_sse41(const uint8_t *w, const int8_t *input,
+                                                         int16_t *acc) {
+  constexpr int BYTES = 8;
+  constexpr int STRIDE = int4_stride(inputs);
+  constexpr int CHUNKS = inputs / 2 / BYTES;
+  constexpr int TAIL = CHUNKS * BYTES * 2;
+  if constexpr (CHUNKS == 0) {
+    project_inputs_int4_scalar(inputs, hidden, w, input, acc);
+  } else {
+    alignas(32) int16_t even[CHUNKS][BYTES], odd[CHUNKS][BYTES];
+    split_int4(input, even, odd);
+    for (auto i = 0; i < hidden; ++i) {
+      const uint8_t *row = w + i * STRIDE;
+      __m128i sum = _mm_setzero_si128();
+      for (auto c = 0; c < CHUNKS; ++c) {
+        const __m128i bytes =
+            _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(row + c * BYTES)));
+        const __m128i lo = _mm_srai_epi16(_mm_slli_epi16(bytes, 12), 12);
+        const __m128i hi = _mm_srai_epi16(_mm_slli_epi16(bytes, 8), 12);
+        const __m128i e = _mm_load_si128(reinterpret_cast<const __m128i *>(even[c]));
+        const __m128i o = _mm_load_si128(reinterpret_cast<const __m128i *>(odd[c]));
+        sum = _mm_add_epi16(sum, _mm_srai_epi16(_mm_mullo_epi16(lo, e), 8 - INT4_SHIFT));
+        sum = _mm_add_epi16(sum, _mm_srai_epi16(_mm_mullo_epi16(hi, o), 8 - INT4_SHIFT));
+      }
+      sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+      sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 4));
+      sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 2));
+      int16_t a = static_cast<int16_t>(acc[i] + static_cast<int16_t>(_mm_extract_epi16(sum, 0)));
+      for (auto j = TAIL; j < inputs; ++j) {
+        a += (int4_at(row, j) * static_cast<int16_t>(input[j]) >> (8 - INT4_SHIFT));
+      }
+      acc[i] = a;
+    }
+  }
+}
+
+// accumulate_int4 on SSE4.1, which AVX2 machines run too
+SNN_SIMD_TARGET("sse4.1")
+inline void accumulate_int4_sse41(int length, const uint8_t *row, int16_t *acc) {
+  int k = 0;
+  for (; k + 16 <= length; k += 16) {
+    const __m128i bytes =
+        _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(row + k / 2)));
+    const __m128i lo = _mm_srai_epi16(_mm_slli_epi16(bytes, 12), 12);
+    const __m128i hi = _mm_srai_epi16(_mm_slli_epi16(bytes, 8), 12);
+    // interleave back to weight order
+    const __m128i first = _mm_slli_epi16(_mm_unpacklo_epi16(lo, hi), INT4_SHIFT);
+    const __m128i second = _mm_slli_epi16(_mm_unpackhi_epi16(lo, hi), INT4_SHIFT);
+    __m128i *out = reinterpret_cast<__m128i *>(acc + k);
+    _mm_storeu_si128(out, _mm_add_epi16(_mm_loadu_si128(out), first));
+    _mm_storeu_si128(out + 1, _mm_add_epi16(_mm_loadu_si128(out + 1), second));
+  }
+  accumulate_int4_scalar(k, length, row, acc);
+}
+#elif defined(SNN_SIMD_NEON)
+template <int inputs, int hidden>
+void project_inputs_int4_neon(const uint8_t *w, const int8_t *input, int16_t *acc) {
+  constexpr int BYTES = 8;
+  constexpr int STRIDE = int4_stride(inputs);
+  constexpr int CHUNKS = inputs / 2 / BYTES;
+  constexpr int TAIL = CHUNKS * BYTES * 2;
+  if constexpr (CHUNKS == 0) {
+    project_inputs_int4_scalar(inputs, hidden, w, input, acc);
+  } else {
+    alignas(32) int16_t even[CHUNKS][BYTES], odd[CHUNKS][BYTES];
+    split_int4(input, even, odd);
+    for (auto i = 0; i < hidden; ++i) {
+      const uint8_t *row = w + i * STRIDE;
+      int16x8_t sum = vdupq_n_s16(0);
+      for (auto c = 0; c < CHUNKS; ++c) {
+        const int16x8_t bytes = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(row + c * BYTES)));
+        const int16x8_t lo = vshrq_n_s16(vshlq_n_s16(bytes, 12), 12);
+        const int16x8_t hi = vshrq_n_s16(vshlq_n_s16(bytes, 8), 12);
+        sum = vaddq_s16(sum, vshrq_n_s16(vmulq_s16(lo, vld1q_s16(even[c])), 8 - INT4_SHIFT));
+        sum = vaddq_s16(sum, vshrq_n_s16(vmulq_s16(hi, vld1q_s16(odd[c])), 8 - INT4_SHIFT));
+      }
+      int16_t a = static_cast<int16_t>(acc[i] + vaddvq_s16(sum));
+      for (auto j = TAIL; j < inputs; ++j) {
+        a += (int4_at(row, j) * static_cast<int16_t>(input[j]) >> (8 - INT4_SHIFT));
+      }
+      acc[i] = a;
+    }
+  }
+}
+
+inline void accumulate_int4_neon(int length, const uint8_t *row, int16_t *acc) {
+  int k = 0;
+  for (; k + 16 <= length; k += 16) {
+    const int16x8_t bytes = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(row + k / 2)));
+    const int16x8_t lo = vshrq_n_s16(vshlq_n_s16(bytes, 12), 12);
+    const int16x8_t hi = vshrq_n_s16(vshlq_n_s16(bytes, 8), 12);
+    vst1q_s16(acc + k, vaddq_s16(vld1q_s16(acc + k), vshlq_n_s16(vzip1q_s16(lo, hi), INT4_SHIFT)));
+    vst1q_s16(acc + k + 8,
+              vaddq_s16(vld1q_s16(acc + k + 8), vshlq_n_s16(vzip2q_s16(lo, hi), INT4_SHIFT)));
+  }
+  accumulate_int4_scalar(k, length, row, acc);
+}
+#endif
+
+template <int inputs, int hidden>
+void project_inputs_int4(const uint8_t *w, const int8_t *input, int16_t *acc) {
+  switch (active) {
+#if defined(SNN_SIMD_X86)
+  case Isa::avx2:
+    project_inputs_int4_avx2<inputs, hidden>(w, input, acc);
+    return;
+  case Isa::sse41:
+    project_inputs_int4_sse41<inputs, hidden>(w, input, acc);
+    return;
+#elif defined(SNN_SIMD_NEON)
+  case Isa::neon:
+    project_inputs_int4_neon<inputs, hidden>(w, input, acc);
+    return;
+#endif
+  default:
+    project_inputs_int4_scalar(inputs, hidden, w, input, acc);
+  }
+}
+
+// acc[k] += w[k] << INT4_SHIFT for the first length weights of one packed row
+inline void accumulate_int4(int length, const uint8_t *row, int16_t *acc) {
+  switch (active) {
+#if defined(SNN_SIMD_X86)
+  case Isa::avx2:
+  case Isa::sse41:
+    accumulate_int4_sse41(length, row, acc);
+    return;
+#elif defined(SNN_SIMD_NEON)
+  case Isa::neon:
+    accumulate_int4_neon(length, row, acc);
+    return;
+#endif
+  default:
+    accumulate_int4_scalar(0, length, row, acc);
+  }
+}
+
+} // namespace snn_simd
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+
+#include "snn.h"
+
+struct STDPParams {
+  // weight change, in int8 steps, for a pairing at full trace (trace 255)
+  uint8_t a_plus = 4;  // potentiation, pre before post
+  uint8_t a_minus = 4; // depression, post before pre
+  uint8_t a_input = 2; // input weights, at full input trace (|trace| 127)
+  // traces decay by trace >> shift every step, so a shift of s is a time constant of about 2^s
+  uint8_t tau_plus_shift = 2;
+  uint8_t tau_minus_shift = 2;
+  uint8_t tau_input_shift = 2;
+};
+
+// Trace-based spike-timing-dependent plasticity for SNN's w_hidden_hidden and w_hidden_input.
+// every hidden neuron keeps a presynaptic and a postsynaptic trace (uint8, bumped to 255 when it
+// spikes and decaying geometrically). call step() after SNN::update:
+// - a neuron i that spiked is potentiated along its incoming recurrent weights (j -> i) by
+//   a_plus * pre_trace[j], and its input row by a_input * input_trace
+// - a neuron j that spiked is depressed along its outgoing recurrent weights (j -> i) by
+//   a_minus * post_trace[i]
+// inputs are not spikes, so their trace is a leaky average of the signed input and the input rule
+// is Hebbian: correlated input strengthens, anti-correlated input weakens.
+// traces of this step's spikes are bumped after the weight updates, so a neuron never pairs with
+// itself within one step. every update saturates in int8. the work is O(hidden) for the traces plus
+// O(spikes * (hidden + inputs)) for the weights, so plasticity keeps the step O(spikes).
+template <int inputs, int hidden, int outputs> struct SNNPlasticity {
+  array<uint8_t, hidden> pre_trace{};
+  array<uint8_t, hidden> post_trace{};
+  array<int8_t, inputs> input_trace{};
+  STDPParams params;
+
+  void clear() {
+    pre_trace.fill(0);
+    post_trace.fill(0);
+    input_trace.fill(0);
+  }
+
+  void step(SNN<inputs, hidden, outputs> &net, std::span<int8_t const> input) {
+    array<uint16_t, hidden> spikes;
+    const int spike_count = net.collect_spikes(spikes);
+
+    for (auto s = 0; s < spike_count; ++s) {
+      const int i = spikes[s];
+      // potentiate j -> i, a strided column of the pre-major weights
+      for (auto j = 0; j < hidden; ++j) {
+        int8_t &w = net.w_hidden_hidden[j * hidden + i];
+        w = saturating_add(w, scale(params.a_plus, pre_trace[j]));
+      }
+      int8_t *row = &net.w_hidden_input[i * inputs];
+      for (auto j = 0; j < inputs; ++j) {
+        row[j] = saturating_add(row[j], (params.a_input * input_trace[j] + 64) >> 7);
+      }
+    }
+    for (auto s = 0; s < spike_count; ++s) {
+      // depress j -> i, a contiguous row
+      int8_t *row = &net.w_hidden_hidden[spikes[s] * hidden];
+      for (auto i = 0; i < hidden; ++i) {
+        row[i] = saturating_add(row[i], -scale(params.a_minus, post_trace[i]));
+      }
+    }
+
+    for (auto i = 0; i < hidden; ++i) {
+      pre_trace[i] -= pre_trace[i] >> params.tau_plus_shift;
+      post_trace[i] -= post_trace[i] >> params.tau_minus_shift;
+    }
+    for (auto s = 0; s < spike_count; ++s) {
+      pre_trace[spikes[s]] = 255;
+      post_trace[spikes[s]] = 255;
+    }
+    for (auto j = 0; j < inputs; ++j) {
+      input_trace[j] = static_cast<int8_t>(input_trace[j] +
+                                           ((input[j] - input_trace[j]) >> params.tau_input_shift));
+    }
+  }
+
+private:
+  // a * trace / 255, rounded
+  static int scale(uint8_t a, uint8_t trace) {
+    return (a * trace + 127) / 255;
+  }
+
+  static int8_t saturating_add(int8_t w, int delta) {
+    return static_cast<int8_t>(std::clamp(w + delta, -128, 127));
+  }
+};
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "snn.h"
+
+// one recurrent connection pre -> post
+struct Synapse {
+  uint16_t pre;
+  uint16_t post;
+  int8_t weight;
+};
+
+// Recurrent weight storage policies for SparseSNN. both are indexed by presynaptic neuron so a
+// spike only touches its own outgoing synapses.
+
+// compressed sparse rows: synapses of pre j are targets/weights[offsets[j], offsets[j + 1])
+template <int hidden> struct CSRWeights {
+  std::vector<uint32_t> offsets = std::vector<uint32_t>(hidden + 1, 0);
+  std::vector<uint16_t> targets;
+  std::vector<int8_t> weights;
+
+  void build(std::span<const Synapse> synapses) {
+    std::fill(offsets.begin(), offsets.end(), 0);
+    for (const auto &s : synapses)
+      ++offsets[s.pre + 1];
+    for (auto j = 0; j < hidden; ++j)
+      offsets[j + 1] += offsets[j];
+
+    targets.resize(synapses.size());
+    weights.resize(synapses.size());
+    std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+    for (const auto &s : synapses) {
+      const auto k = cursor[s.pre]++;
+      targets[k] = s.post;
+      weights[k] = s.weight;
+    }
+  }
+
+  void accumulate(int pre, int16_t *acc) const {
+    for (auto k = offsets[pre]; k < offsets[pre + 1]; ++k) {
+      acc[targets[k]] = static_cast<int16_t>(acc[targets[k]] + weights[k]);
+    }
+  }
+
+  std::size_t synapse_count() const {
+    return weights.size();
+  }
+  std::size_t bytes() const {
+    return offsets.size() * sizeof(uint32_t) + targets.size() * sizeof(uint16_t) + weights.size();
+  }
+};
+
+// ELLPACK: every pre gets the same number of slots (the largest fan-out), padded with zero weights.
+// no offsets to chase and a fixed trip count, at the cost of padding when fan-out is uneven.
+template <int hidden> struct ELLWeights {
+  int width = 0;
+  std::size_t count = 0;         // synapses, not counting padding
+  std::vector<uint16_t> targets; // [pre][slot]
+  std::vector<int8_t> weights;   // [pre][slot]
+
+  void build(std::span<const Synapse> synapses) {
+    std::vector<int> fan_out(hidden, 0);
+    for (const auto &s : synapses)
+      ++fan_out[s.pre];
+    width = hidden > 0 ? *std::max_element(fan_out.begin(), fan_out.end()) : 0;
+    count = synapses.size();
+
+    targets.assign(hidden * width, 0);
+    weights.assign(hidden * width, 0);
+    std::fill(fan_out.begin(), fan_out.end(), 0);
+    for (const auto &s : synapses) {
+      const auto k = s.pre * width + fan_out[s.pre]++;
+      targets[k] = s.post;
+      weights[k] = s.weight;
+    }
+  }
+
+  void accumulate(int pre, int16_t *acc) const {
+    const uint16_t *t = &targets[pre * width];
+    const int8_t *w = &weights[pre * width];
+    for (auto k = 0; k < width; ++k) {
+      acc[t[k]] = static_cast<int16_t>(acc[t[k]] + w[k]);
+    }
+  }
+
+  std::size_t synapse_count() const {
+    return count;
+  }
+  std::size_t bytes() const {
+    return targets.size() * sizeof(uint16_t) + weights.size();
+  }
+};
+
+// SNN with sparse recurrent connectivity, for large evolved brains where most of w_hidden_hidden is
+// zero. same interface and arithmetic as SNN; loading a dense SNN gives bit-identical steps. memory
+// and recurrent cost grow with the number of synapses instead of hidden^2, and everything lives on
+// the heap so hidden can be in the thousands.
+template <int inputs, int hidden, int outputs, template <int> class Recurrent = CSRWeights>
+struct SparseSNN {
+  static_assert(hidden <= 65536, "neuron indices are 16 bit");
+
+  std::vector<int8_t> w_hidden_input = std::vector<int8_t>(hidden * inputs);
+  Recurrent<hidden> w_hidden_hidden;
+  // stored per presynaptic neuron, like SNN::w_output_hidden
+  std::vector<int8_t> w_output_hidden = std::vector<int8_t>(hidden * outputs);
+  std::vector<uint8_t> b_hidden = std::vector<uint8_t>(hidden);
+  std::vector<uint8_t> s_hidden = std::vector<uint8_t>(hidden);
+  std::vector<uint64_t> act_hidden = std::vector<uint64_t>(spike_words(hidden));
+
+  bool spiked(int i) const {
+    return (act_hidden[i / 64] >> (i % 64)) & 1;
+  }
+
+  void init(std::mt19937 &rng, int fan_out = std::min(hidden, 32)) {
+    // same ranges as SNN::init, with the recurrent fan-in being the expected fan-out
+    float input_scale = std::sqrt(2.0f / inputs);
+    int input_range = std::clamp(static_cast<int>(64 * input_scale), 1, 127);
+    std::uniform_int_distribution<int> dist_input(-input_range, input_range);
+
+    float hidden_scale = std::sqrt(1.0f / std::max(fan_out, 1));
+    int hidden_range = std::clamp(static_cast<int>(128 * hidden_scale), 1, 127);
+    std::uniform_int_distribution<int> dist_hidden(-hidden_range, hidden_range);
+
+    float output_scale = std::sqrt(1.0f / hidden);
+    int output_range = std::clamp(static_cast<int>(128 * output_scale), 1, 127);
+    std::uniform_int_distribution<int> dist_output(-output_range, output_range);
+
+    std::uniform_int_distribution<int> dist_bias(input_range / 2, input_range);
+    std::uniform_int_distribution<int> dist_post(0, hidden - 1);
+
+    for (auto &w : w_hidden_input)
+      w = static_cast<int8_t>(dist_input(rng));
+    std::vector<Synapse> synapses;
+    synapses.reserve(hidden * fan_out);
+    for (auto j = 0; j < hidden; ++j) {
+      for (auto k = 0; k < fan_out; ++k) {
+        synapses.push_back({static_cast<uint16_t>(j), static_cast<uint16_t>(dist_post(rng)),
+                            static_cast<int8_t>(dist_hidden(rng))});
+      }
+    }
+    w_hidden_hidden.build(synapses);
+    for (auto &w : w_output_hidden)
+      w = static_cast<int8_t>(dist_output(rng));
+    for (auto &b : b_hidden)
+      b = static_cast<uint8_t>(dist_bias(rng));
+
+    clear();
+  }
+
+  // copy a dense network, keeping only its non-zero recurrent weights
+  void load(const SNN<inputs, hidden, outputs> &net) {
+    std::copy(net.w_hidden_input.begin(), net.w_hidden_input.end(), w_hidden_input.begin());
+    std::copy(net.w_output_hidden.begin(), net.w_output_hidden.end(), w_output_hidden.begin());
+    std::copy(net.b_hidden.begin(), net.b_hidden.end(), b_hidden.begin());
+    std::copy(net.s_hidden.begin(), net.s_hidden.end(), s_hidden.begin());
+    std::copy(net.act_hidden.begin(), net.act_hidden.end(), act_hidden.begin());
+
+    std::vector<Synapse> synapses;
+    for (auto j = 0; j < hidden; ++j) {
+      for (auto i = 0; i < hidden; ++i) {
+        const int8_t w = net.w_hidden_hidden[j * hidden + i];
+        if (w != 0) {
+          synapses.push_back({static_cast<uint16_t>(j), static_cast<uint16_t>(i), w});
+        }
+      }
+    }
+    w_hidden_hidden.build(synapses);
+  }
+
+  void clear() {
+    std::fill(s_hidden.begin(), s_hidden.end(), 0);
+    std::fill(act_hidden.begin(), act_hidden.end(), 0);
+  }
+
+  void update(std::span<int8_t const> input) {
+    snn_kernels::integrate_inputs<inputs, hidden>(s_hidden.data(), b_hidden.data(),
+                                                  w_hidden_input.data(), input.data(), acc.data());
+
+    // add recurrent connections, only the synapses of neurons that spiked last step
+    const int spike_count = snn_kernels::collect_spikes(hidden, act_hidden.data(), spikes.data());
+    for (auto s = 0; s < spike_count; ++s) {
+      w_hidden_hidden.accumulate(spikes[s], acc.data());
+    }
+
+    snn_kernels::fire(hidden, acc.data(), s_hidden.data(), act_hidden.data());
+  }
+
+  void get_output(std::vector<int16_t> &output) {
+    output.resize(outputs);
+    const int spike_count = snn_kernels::collect_spikes(hidden, act_hidden.data(), spikes.data());
+    snn_kernels::read_outputs(outputs, w_output_hidden.data(), spikes.data(), spike_count,
+                              output.data());
+  }
+
+private:
+  // scratch for update, kept here so large networks don't put it on the stack
+  std::vector<int16_t> acc = std::vector<int16_t>(hidden);
+  std::vector<uint16_t> spikes = std::vector<uint16_t>(hidden);
+};
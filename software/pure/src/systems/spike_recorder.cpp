@@ -0,0 +1,320 @@
+#include "spike_recorder.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace {
+
+constexpr char MAGIC[8] = {'S', 'N', 'N', 'S', 'P', 'I', 'K', 'E'};
+constexpr uint32_t VERSION = 1;
+
+// the longest encoding of a tick delta, count or id gap, all 32-bit
+constexpr std::size_t MAX_VARINT32 = 5;
+
+uint8_t *put_varint(uint8_t *out, uint64_t v) {
+  while (v >= 0x80) {
+    *out++ = static_cast<uint8_t>(v | 0x80);
+    v >>= 7;
+  }
+  *out++ = static_cast<uint8_t>(v);
+  return out;
+}
+
+// one chunk from its raw track buffer into the block format. returns the number of spikes
+uint32_t encode(std::span<const uint64_t> raw, std::size_t words_per_tick,
+                std::vector<uint8_t> &out) {
+  const std::size_t stride = 1 + words_per_tick;
+  const std::size_t ticks = raw.size() / stride;
+  uint32_t spikes = 0;
+  for (std::size_t t = 0; t < ticks; ++t) {
+    for (std::size_t w = 1; w < stride; ++w)
+      spikes += std::popcount(raw[t * stride + w]);
+  }
+  // grow once to the worst case and trim after, rather than a capacity check per byte
+  out.resize((2 * ticks + spikes) * MAX_VARINT32);
+  uint8_t *p = out.data();
+  uint64_t last_tick = 0;
+  for (std::size_t t = 0; t < ticks; ++t) {
+    const uint64_t tick = raw[t * stride];
+    const uint64_t *act = &raw[t * stride + 1];
+    p = put_varint(p, tick - last_tick);
+    last_tick = tick;
+    // repeats only refer back within the chunk, so every block decodes on its own
+    if (t > 0 && std::equal(act, act + words_per_tick, act - stride)) {
+      p = put_varint(p, 0);
+      continue;
+    }
+    int count = 0;
+    for (std::size_t w = 0; w < words_per_tick; ++w)
+      count += std::popcount(act[w]);
+    p = put_varint(p, count);
+    uint32_t previous = 0;
+    for (std::size_t w = 0; w < words_per_tick; ++w) {
+      for (uint64_t bits = act[w]; bits != 0; bits &= bits - 1) {
+        const auto neuron = static_cast<uint32_t>(w * 64 + std::countr_zero(bits));
+        p = put_varint(p, neuron - previous);
+        previous = neuron;
+      }
+    }
+  }
+  out.resize(p - out.data());
+  return spikes;
+}
+
+uint64_t get_varint(const uint8_t *&p) {
+  uint64_t v = 0;
+  for (int shift = 0;; shift += 7) {
+    const uint8_t byte = *p++;
+    v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (byte < 0x80)
+      return v;
+  }
+}
+
+} // namespace
+
+SpikeRecorder::~SpikeRecorder() {
+  close();
+}
+
+bool SpikeRecorder::open(const std::string &path, uint32_t networks, uint32_t neurons,
+                         uint32_t chunk_ticks) {
+  close();
+  data = std::fopen(path.c_str(), "wb");
+  index = std::fopen((path + ".index").c_str(), "wb");
+  Header header{};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.networks = networks;
+  header.neurons = neurons;
+  header.chunk_ticks = chunk_ticks;
+  if (data == nullptr || index == nullptr || chunk_ticks == 0 ||
+      std::fwrite(&header, sizeof(header), 1, data) != 1) {
+    close();
+    return false;
+  }
+
+  m_neurons = neurons;
+  words_per_tick = (neurons + 63) / 64;
+  this->chunk_ticks = chunk_ticks;
+  tracks.assign(networks, Track{});
+  sealed.clear();
+  for (uint32_t n = 0; n < networks; ++n)
+    sealed.push_back({n, 0, {}});
+  pending_seal.assign(networks, 0);
+  pending = 0;
+  m_bytes = 0;
+  offset = sizeof(Header);
+  stopping = false;
+  failed = false;
+  writer = std::thread(&SpikeRecorder::write_loop, this);
+  return true;
+}
+
+void SpikeRecorder::close() {
+  if (writer.joinable()) {
+    flush();
+    {
+      std::lock_guard lock(mutex);
+      stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+  }
+  if (data != nullptr)
+    std::fclose(data);
+  if (index != nullptr)
+    std::fclose(index);
+  data = nullptr;
+  index = nullptr;
+  tracks.clear();
+  sealed.clear();
+  spare.clear();
+}
+
+bool SpikeRecorder::record(uint32_t network, uint64_t tick, std::span<const uint64_t> act) {
+  if (network >= tracks.size() || act.size() != words_per_tick)
+    return false;
+  Track &track = tracks[network];
+  // ticks don't go backwards, so this only divides when a chunk starts
+  if (tick < track.first_tick || tick - track.first_tick >= chunk_ticks) {
+    if (track.used != 0)
+      seal(network);
+    track.first_tick = tick / chunk_ticks * chunk_ticks;
+  }
+
+  uint64_t any = 0;
+  for (auto word : act)
+    any |= word;
+  if (any == 0)
+    return true;
+  const std::size_t stride = 1 + act.size();
+  if (track.used + stride > track.raw.size()) {
+    // recycled buffers arrive full size, so this only runs for fresh ones or busier chunks
+    track.raw.resize(std::max({track.raw.capacity(), 2 * track.raw.size(), 64 * stride}));
+  }
+  uint64_t *out = &track.raw[track.used];
+  out[0] = tick - track.first_tick;
+  std::copy(act.begin(), act.end(), out + 1);
+  track.used += stride;
+  return true;
+}
+
+void SpikeRecorder::seal(uint32_t network) {
+  if (pending_seal[network]) {
+    // end_tick wasn't called since the last seal, so hand that chunk over on its own
+    std::lock_guard lock(mutex);
+    hand_over(network);
+    pending.fetch_sub(1, std::memory_order_relaxed);
+    wake.notify_one();
+  }
+  Track &track = tracks[network];
+  track.raw.resize(track.used);
+  sealed[network].first_tick = track.first_tick;
+  std::swap(sealed[network].raw, track.raw);
+  track.used = 0;
+  track.first_tick = ~uint64_t{0};
+  pending_seal[network] = 1;
+  pending.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SpikeRecorder::hand_over(uint32_t network) {
+  queue.push_back(std::move(sealed[network]));
+  sealed[network] = {network, 0, {}};
+  if (!spare.empty()) {
+    sealed[network].raw = std::move(spare.back());
+    spare.pop_back();
+  }
+  pending_seal[network] = 0;
+}
+
+void SpikeRecorder::end_tick() {
+  if (pending.load(std::memory_order_relaxed) == 0)
+    return;
+  {
+    std::lock_guard lock(mutex);
+    for (uint32_t n = 0; n < tracks.size(); ++n) {
+      if (pending_seal[n])
+        hand_over(n);
+    }
+    pending.store(0, std::memory_order_relaxed);
+  }
+  wake.notify_one();
+}
+
+bool SpikeRecorder::flush() {
+  if (!writer.joinable())
+    return false;
+  for (uint32_t n = 0; n < tracks.size(); ++n) {
+    if (tracks[n].used != 0)
+      seal(n);
+    tracks[n].first_tick = ~uint64_t{0};
+  }
+  end_tick();
+  std::unique_lock lock(mutex);
+  drained.wait(lock, [this] { return queue.empty() && in_flight == 0; });
+  return !failed;
+}
+
+void SpikeRecorder::write_loop() {
+  std::unique_lock lock(mutex);
+  while (true) {
+    wake.wait(lock, [this] { return stopping || !queue.empty(); });
+    if (queue.empty() && stopping)
+      return;
+    Sealed sealed = std::move(queue.front());
+    queue.pop_front();
+    ++in_flight;
+    lock.unlock();
+
+    Block block{sealed.network, 0, sealed.first_tick, offset, 0};
+    block.spikes = encode(sealed.raw, words_per_tick, encoded);
+    block.size = encoded.size();
+    bool written = std::fwrite(encoded.data(), 1, encoded.size(), data) == encoded.size();
+    written = written && std::fwrite(&block, sizeof(Block), 1, index) == 1;
+    offset += encoded.size();
+    m_bytes += encoded.size();
+
+    lock.lock();
+    --in_flight;
+    failed = failed || !written;
+    // back at full size, so the track that gets it doesn't fill it on the stepping thread
+    sealed.raw.resize(sealed.raw.capacity());
+    spare.push_back(std::move(sealed.raw));
+    if (queue.empty()) {
+      // readers map the files, so make what's written visible before reporting it drained
+      std::fflush(data);
+      std::fflush(index);
+      drained.notify_all();
+    }
+  }
+}
+
+bool SpikeReader::open(const std::string &path) {
+  blocks.clear();
+  if (!mapped_data.map(path) || !mapped_index.map(path + ".index"))
+    return false;
+  SpikeRecorder::Header header;
+  if (mapped_data.size() < sizeof(header))
+    return false;
+  std::memcpy(&header, mapped_data.data(), sizeof(header));
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION)
+    return false;
+  m_networks = header.networks;
+  m_neurons = header.neurons;
+  m_chunk_ticks = header.chunk_ticks;
+
+  blocks.resize(m_networks);
+  const auto *entries = reinterpret_cast<const SpikeRecorder::Block *>(mapped_index.data());
+  const std::size_t count = mapped_index.size() / sizeof(SpikeRecorder::Block);
+  for (std::size_t k = 0; k < count; ++k) {
+    const auto &block = entries[k];
+    if (block.network < m_networks && block.offset + block.size <= mapped_data.size())
+      blocks[block.network].push_back(&block);
+  }
+  // the writer emits a network's chunks in order, but sort in case several runs were appended
+  for (auto &list : blocks) {
+    std::stable_sort(list.begin(), list.end(),
+                     [](const auto *a, const auto *b) { return a->first_tick < b->first_tick; });
+  }
+  return true;
+}
+
+bool SpikeReader::read(uint32_t network, uint64_t begin, uint64_t end,
+                       std::vector<Spike> &out) const {
+  if (network >= m_networks)
+    return false;
+  const auto &list = blocks[network];
+  // first block whose chunk reaches begin. a flush mid-chunk leaves several blocks with the same
+  // first tick, so this can't just look for the last block starting at or before begin
+  auto it = std::partition_point(list.begin(), list.end(), [&](const auto *block) {
+    return block->first_tick + m_chunk_ticks <= begin;
+  });
+  std::vector<uint32_t> previous;
+  for (; it != list.end() && (*it)->first_tick < end; ++it) {
+    const uint8_t *p = mapped_data.data() + (*it)->offset;
+    const uint8_t *stop = p + (*it)->size;
+    uint64_t tick = (*it)->first_tick;
+    previous.clear();
+    while (p < stop) {
+      tick += get_varint(p);
+      const auto count = static_cast<uint32_t>(get_varint(p));
+      if (count != 0) {
+        previous.clear();
+        uint32_t neuron = 0;
+        for (uint32_t k = 0; k < count; ++k) {
+          neuron += static_cast<uint32_t>(get_varint(p));
+          previous.push_back(neuron);
+        }
+      }
+      if (tick >= end)
+        return true;
+      if (tick >= begin) {
+        for (auto neuron : previous)
+          out.push_back({tick, neuron});
+      }
+    }
+  }
+  return true;
+}
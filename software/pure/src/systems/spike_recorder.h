@@ -0,0 +1,164 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "genome_archive.h"
+
+// Compressed spike trains of many networks over long runs. time is cut into chunks of chunk_ticks
+// ticks, and every network's spikes in one chunk become one self-contained block:
+//   per tick with spikes: varint(tick delta) varint(count) then count varint neuron-id deltas
+// the first tick delta is from the chunk start, later ones from the previous spiking tick; ids are
+// ascending, so each is stored as the gap from the previous id. silent ticks cost nothing, and a
+// count of 0 repeats the previous tick's spikes, so steady firing patterns cost two bytes a tick.
+// two files, like GenomeArchive:
+// - path holds a small header, then the blocks in the order they were written
+// - path + ".index" holds one SpikeRecorder::Block per block (network, first tick, offset, size)
+// recording only appends the raw act words of ticks with spikes to the network's open chunk;
+// finished chunks are handed to a background thread that encodes and writes them, so the stepping
+// thread neither encodes nor waits on the disk. the writer hands emptied buffers back, so steady
+// recording doesn't allocate.
+class SpikeRecorder {
+public:
+  struct Block {
+    uint32_t network;
+    uint32_t spikes;
+    uint64_t first_tick; // chunk start
+    uint64_t offset;     // in the data file
+    uint64_t size;
+  };
+
+  SpikeRecorder() = default;
+  SpikeRecorder(const SpikeRecorder &) = delete;
+  SpikeRecorder &operator=(const SpikeRecorder &) = delete;
+  ~SpikeRecorder();
+
+  // creates (or truncates) a recording and starts the writer thread
+  bool open(const std::string &path, uint32_t networks, uint32_t neurons,
+            uint32_t chunk_ticks = 1024);
+  // flushes and stops the writer
+  void close();
+
+  // spikes of one network at one tick, neuron i being bit i % 64 of act[i / 64]. act must hold
+  // (neurons + 63) / 64 words and bits past neurons must be clear. ticks must not go backwards for
+  // a network. different networks may be recorded from different threads at once. returns false,
+  // recording nothing, if network or act.size() doesn't match the recording
+  bool record(uint32_t network, uint64_t tick, std::span<const uint64_t> act);
+
+  // hands the chunks sealed since the last call to the writer, under one lock and with one wake-up.
+  // call once a tick after recording every network, while no thread is recording. without it
+  // chunks still reach the writer, one at a time when their track seals again
+  void end_tick();
+
+  // hands every open chunk to the writer and waits until everything is on disk. no thread may be
+  // recording meanwhile
+  bool flush();
+
+  // bytes the writer has encoded so far. complete after flush()
+  uint64_t bytes() const {
+    return m_bytes;
+  }
+
+private:
+  friend class SpikeReader;
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t networks;
+    uint32_t neurons;
+    uint32_t chunk_ticks;
+    uint8_t reserved[40];
+  };
+  static_assert(sizeof(Header) == 64);
+  static_assert(sizeof(Block) == 32);
+
+  struct Sealed {
+    uint32_t network;
+    uint64_t first_tick;
+    std::vector<uint64_t> raw;
+  };
+  // one network's open chunk, unencoded: per tick with spikes, the tick from the chunk start and
+  // then its act words. one buffer, so a record touches one place besides the track. raw is kept
+  // at its full size and used counts what's filled, so appending doesn't resize per tick
+  struct Track {
+    uint64_t first_tick = ~uint64_t{0}; // chunk start, or none open
+    std::size_t used = 0;
+    std::vector<uint64_t> raw;
+  };
+
+  uint32_t m_neurons = 0;
+  uint32_t words_per_tick = 0;
+  uint32_t chunk_ticks = 0;
+  std::vector<Track> tracks;
+  // per network, its last sealed chunk until end_tick hands it over. the buffer is a spare
+  // otherwise, so sealing is a swap
+  std::vector<Sealed> sealed;
+  std::vector<uint8_t> pending_seal;
+  std::atomic<uint64_t> m_bytes{0};
+
+  std::FILE *data = nullptr;
+  std::FILE *index = nullptr;
+  uint64_t offset = sizeof(Header); // writer-only
+  std::vector<uint8_t> encoded;     // writer-only
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable drained;
+  std::deque<Sealed> queue;
+  std::vector<std::vector<uint64_t>> spare; // emptied buffers, back from the writer
+  std::atomic<int> pending{0};              // tracks with a sealed chunk not handed over
+  int in_flight = 0;
+  bool stopping = false;
+  bool failed = false;
+  std::thread writer;
+
+  void seal(uint32_t network);
+  // moves a network's sealed chunk to the queue and gives it a spare buffer. mutex must be held
+  void hand_over(uint32_t network);
+  void write_loop();
+};
+
+// Random access into a SpikeRecorder file. maps both files, so opening is cheap and reads only
+// decode the blocks that overlap the asked range
+class SpikeReader {
+public:
+  struct Spike {
+    uint64_t tick;
+    uint32_t neuron;
+  };
+
+  bool open(const std::string &path);
+
+  uint32_t networks() const {
+    return m_networks;
+  }
+  uint32_t neurons() const {
+    return m_neurons;
+  }
+  uint32_t chunk_ticks() const {
+    return m_chunk_ticks;
+  }
+
+  // spikes of network in ticks [begin, end), in tick then neuron order, appended to out. returns
+  // false if the recording has no such network
+  bool read(uint32_t network, uint64_t begin, uint64_t end, std::vector<Spike> &out) const;
+
+private:
+  uint32_t m_networks = 0;
+  uint32_t m_neurons = 0;
+  uint32_t m_chunk_ticks = 0;
+  MappedFile mapped_data;
+  MappedFile mapped_index;
+  // per network, its blocks in tick order
+  std::vector<std::vector<const SpikeRecorder::Block *>> blocks;
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+struct SpikeEvent {
+  uint32_t tick; // low 32 bits of the simulation tick
+  uint32_t network;
+  uint32_t neuron;
+};
+
+// Broadcast stream of spike events with one producer and up to max_consumers readers, in the style
+// of a Disruptor: events go into a power-of-two ring, the producer publishes a cursor, and every
+// consumer keeps its own read sequence and sees every event. the producer never overwrites an
+// event some consumer hasn't read yet; when the slowest consumer is a full ring behind, publish
+// drops the rest of the batch and counts it in dropped().
+// the stepping thread publishes after each update; consumers poll from any thread.
+template <std::size_t Size = 1 << 16, int max_consumers = 8> class SpikeStream {
+  static_assert((Size & (Size - 1)) == 0, "Size must be a power of 2");
+  static constexpr std::size_t MASK = Size - 1;
+  static constexpr uint64_t INACTIVE = UINT64_MAX;
+
+public:
+  SpikeStream() {
+    for (auto &sequence : sequences)
+      sequence.value.store(INACTIVE, std::memory_order_relaxed);
+  }
+
+  SpikeStream(const SpikeStream &) = delete;
+  SpikeStream &operator=(const SpikeStream &) = delete;
+
+  // claims a consumer slot that starts at the next published event, or returns -1 when all slots
+  // are taken. call it on the producer's thread, or before publishing starts, so the producer
+  // can't be mid-batch past the new consumer. unsubscribe is safe from any thread
+  int subscribe() {
+    const uint64_t start = cursor.load(std::memory_order_relaxed);
+    for (int c = 0; c < max_consumers; ++c) {
+      uint64_t expected = INACTIVE;
+      if (sequences[c].value.compare_exchange_strong(expected, start, std::memory_order_acq_rel)) {
+        return c;
+      }
+    }
+    return -1;
+  }
+
+  void unsubscribe(int consumer) {
+    sequences[consumer].value.store(INACTIVE, std::memory_order_release);
+  }
+
+  // producer: one event per bit set in act, neuron i being bit i % 64 of act[i / 64]
+  void publish(uint32_t network, uint64_t tick, std::span<const uint64_t> act) {
+    uint64_t next = cursor.load(std::memory_order_relaxed);
+    for (std::size_t w = 0; w < act.size(); ++w) {
+      for (uint64_t bits = act[w]; bits != 0; bits &= bits - 1) {
+        if (next - gate >= Size && !reserve(next)) {
+          m_dropped.fetch_add(std::popcount(bits) + remaining(act, w + 1),
+                              std::memory_order_relaxed);
+          cursor.store(next, std::memory_order_release);
+          return;
+        }
+        buffer[next & MASK] = {static_cast<uint32_t>(tick), network,
+                               static_cast<uint32_t>(w * 64 + std::countr_zero(bits))};
+        ++next;
+      }
+    }
+    cursor.store(next, std::memory_order_release);
+  }
+
+  // consumer: calls f(const SpikeEvent &) for every event published since the last poll, oldest
+  // first, and returns how many there were
+  template <typename F> std::size_t poll(int consumer, F &&f) {
+    auto &sequence = sequences[consumer].value;
+    const uint64_t begin = sequence.load(std::memory_order_relaxed);
+    const uint64_t end = cursor.load(std::memory_order_acquire);
+    for (uint64_t s = begin; s < end; ++s)
+      f(buffer[s & MASK]);
+    // releasing the slots lets the producer reuse them
+    sequence.store(end, std::memory_order_release);
+    return end - begin;
+  }
+
+  // events published since consumer's last poll
+  std::size_t pending(int consumer) const {
+    return cursor.load(std::memory_order_acquire) -
+           sequences[consumer].value.load(std::memory_order_relaxed);
+  }
+
+  uint64_t published() const {
+    return cursor.load(std::memory_order_acquire);
+  }
+  uint64_t dropped() const {
+    return m_dropped.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct alignas(64) Sequence {
+    std::atomic<uint64_t> value;
+  };
+
+  alignas(64) std::atomic<uint64_t> cursor{0};
+  // producer-only: lowest consumer sequence when last checked, so the consumers' cache lines are
+  // only read when the ring looks full
+  uint64_t gate = 0;
+  std::atomic<uint64_t> m_dropped{0};
+  std::array<Sequence, max_consumers> sequences;
+  alignas(64) std::array<SpikeEvent, Size> buffer;
+
+  // refreshes gate and reports whether sequence next can be written
+  bool reserve(uint64_t next) {
+    uint64_t lowest = next;
+    for (const auto &sequence : sequences)
+      lowest = std::min(lowest, sequence.value.load(std::memory_order_acquire));
+    gate = lowest;
+    return next - gate < Size;
+  }
+
+  static std::size_t remaining(std::span<const uint64_t> act, std::size_t from) {
+    std::size_t count = 0;
+    for (std::size_t w = from; w < act.size(); ++w)
+      count += std::popcount(act[w]);
+    return count;
+  }
+};
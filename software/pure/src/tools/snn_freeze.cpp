@@ -0,0 +1,96 @@
+// Emits a header that freezes one genome from a GenomeArchive into a FrozenSNN:
+//   snn_freeze <archive> <inputs> <hidden> <outputs> <name> <header> [record]
+// the record defaults to the fittest in the archive. the header declares
+//   inline constexpr FrozenWeights<inputs, hidden, outputs> <name>_weights
+//   using <name> = FrozenSNN<<name>_weights>;
+
+#include "systems/genome_archive.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace {
+
+// one brace-enclosed array, 16 values per line
+template <typename T> void write_array(std::FILE *out, std::span<const T> values) {
+  std::fputs("    {", out);
+  for (std::size_t k = 0; k < values.size(); ++k) {
+    if (k % 16 == 0)
+      std::fputs("\n        ", out);
+    std::fprintf(out, "%d,%s", static_cast<int>(values[k]), k % 16 == 15 ? "" : " ");
+  }
+  std::fputs("\n    },\n", out);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 7) {
+    std::fprintf(stderr,
+                 "usage: %s <archive> <inputs> <hidden> <outputs> <name> <header> [record]\n",
+                 argv[0]);
+    return 1;
+  }
+  const std::string path = argv[1];
+  const int inputs = std::atoi(argv[2]);
+  const int hidden = std::atoi(argv[3]);
+  const int outputs = std::atoi(argv[4]);
+  const std::string name = argv[5];
+  if (inputs <= 0 || hidden <= 0 || outputs <= 0) {
+    std::fprintf(stderr, "network sizes must be positive\n");
+    return 1;
+  }
+
+  // SNNGenomePool record: w_hidden_input, w_hidden_hidden, w_output_hidden, b_hidden
+  const auto record_size = static_cast<uint32_t>(hidden * (inputs + hidden + outputs) + hidden);
+  GenomeArchive archive;
+  // open() would create a missing archive
+  if (!std::filesystem::exists(path) || !archive.open(path, record_size)) {
+    std::fprintf(stderr, "can't open %s as an archive of %u byte records\n", path.c_str(),
+                 record_size);
+    return 1;
+  }
+  uint64_t index = 0;
+  if (argc > 7) {
+    index = std::strtoull(argv[7], nullptr, 10);
+  } else {
+    std::vector<uint64_t> best;
+    archive.top_k(1, best);
+    index = best.empty() ? 0 : best[0];
+  }
+  if (index >= archive.size()) {
+    std::fprintf(stderr, "record %llu is out of range, the archive has %llu\n",
+                 static_cast<unsigned long long>(index),
+                 static_cast<unsigned long long>(archive.size()));
+    return 1;
+  }
+
+  const auto record = archive.record(index);
+  const auto *w = reinterpret_cast<const int8_t *>(record.data());
+  const auto &entry = archive.entry(index);
+  std::FILE *out = std::fopen(argv[6], "w");
+  if (out == nullptr) {
+    std::fprintf(stderr, "can't write %s\n", argv[6]);
+    return 1;
+  }
+  std::fprintf(out,
+               "// generated by snn_freeze from %s, record %llu (generation %u, fitness %g)\n"
+               "#pragma once\n\n#include \"systems/frozen_snn.h\"\n\n"
+               "inline constexpr FrozenWeights<%d, %d, %d> %s_weights = {\n",
+               std::filesystem::path(path).filename().string().c_str(),
+               static_cast<unsigned long long>(index), entry.generation, entry.fitness, inputs,
+               hidden, outputs, name.c_str());
+  write_array(out, std::span<const int8_t>(w, hidden * inputs));
+  w += hidden * inputs;
+  write_array(out, std::span<const int8_t>(w, hidden * hidden));
+  w += hidden * hidden;
+  write_array(out, std::span<const int8_t>(w, hidden * outputs));
+  write_array(out, record.subspan(record_size - hidden));
+  std::fprintf(out, "};\n\nusing %s = FrozenSNN<%s_weights>;\n", name.c_str(), name.c_str());
+  const bool written = std::fclose(out) == 0;
+  return written ? 0 : 1;
+}